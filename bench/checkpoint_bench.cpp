@@ -0,0 +1,243 @@
+// Measures how long a checkpoint takes to capture, write, read and restore
+// once 3 days of minutes have been computed, and checks that the tick after
+// a restore computes exactly what it would have without the restart. Then
+// restarts after longer and longer gaps: a checkpoint is either refused or
+// its SMA is still the mean of the closes once its window has slid past the
+// gap.
+//
+//   ./bench/checkpoint_bench [symbols] [trades per symbol per minute]
+//
+// Everything is written to a scratch directory under /tmp.
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "bars/bars.hpp"
+#include "checkpoint/checkpoint.hpp"
+#include "data_collector/data_collector.hpp"
+#include "indicators/indicator_engine.hpp"
+#include "measurement/measurement.hpp"
+#include "universe/universe.hpp"
+#include "utils/clock.hpp"
+#include "utils/file_writer.hpp"
+#include "utils/setup.hpp"
+
+static const long START = 1752508800000;  // Minute aligned
+static long minute = 0;
+
+static double nowMs() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// The same deterministic trades for a given minute every time
+static void storeMinute(const std::vector<int>& symbols, int trades) {
+    long minuteStart = START + minute * 60000;
+    for (int t = 0; t < trades; t++) {
+        long ts = minuteStart + t * 60000L / trades;
+        Clock::setVirtualTime(ts);
+        for (size_t i = 0; i < symbols.size(); i++) {
+            double px = 100.0 + i + ((minute * 7 + t * 13 + i) % 101) * 0.01;
+            Measurement::storeMeasurement(
+                symbols[i], Measurement::create(px, 0.5 + t % 3, ts));
+        }
+    }
+}
+
+static void runMinute(const std::vector<int>& symbols, int trades) {
+    storeMinute(symbols, trades);
+    long timestamp = START + (minute + 1) * 60000;
+    Clock::setVirtualTime(timestamp);
+    DataCollector::cleanupOldData(timestamp);
+    Measurement::cleanupOldMeasurements(timestamp);
+    DataCollector::runTick(symbols, timestamp);
+    minute++;
+}
+
+// The newest point of every computed indicator of every symbol
+static std::vector<double> lastPoints(const std::vector<int>& symbols) {
+    std::vector<double> points;
+    for (int symbol : symbols) {
+        for (int i = 0; i < INDICATOR_COUNT; i++) {
+            value_t recent =
+                DataCollector::getRecent((indicator_t)i, symbol, 1);
+            points.push_back(recent.values.empty() ? -1 : recent.values[0]);
+        }
+    }
+    return points;
+}
+
+// Drops everything in memory, as a restart does
+static void clearAll(const std::vector<int>& symbols) {
+    for (int symbol : symbols) {
+        DataCollector::clearSymbol(symbol);
+        Measurement::clearSymbol(symbol);
+        Bars::clearSymbol(symbol);
+    }
+}
+
+// Worst difference between the SMA and the mean of the closes in its window
+static double smaError(const std::vector<int>& symbols) {
+    const size_t window = IndicatorEngine::windowBars(INDICATOR_SMA);
+    double worst = 0;
+    for (int symbol : symbols) {
+        value_t sma = DataCollector::getRecent(INDICATOR_SMA, symbol, 1);
+        value_t close = DataCollector::getRecent(INDICATOR_CLOSE, symbol,
+                                                 window);
+        if (sma.values.empty() || close.values.size() < window) {
+            return INFINITY;
+        }
+        double mean = 0;
+        for (double value : close.values) {
+            mean += value;
+        }
+        mean /= window;
+        worst = std::max(worst, std::fabs(sma.values[0] - mean));
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    const int numSymbols = argc > 1 ? atoi(argv[1]) : 50;
+    const int trades = argc > 2 ? atoi(argv[2]) : 120;
+
+    if (numSymbols < 1 || numSymbols > MAX_SYMBOLS || trades < 1) {
+        fprintf(stderr, "usage: %s [symbols] [trades per minute]\n", argv[0]);
+        return 1;
+    }
+
+    char directory[] = "/tmp/checkpoint_bench.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+        perror("scratch directory");
+        return 1;
+    }
+
+    // Setup and the checkpoint log on stdout, keep that out of the results
+    FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    std::vector<std::string> names;
+    for (int i = 0; i < numSymbols; i++) {
+        char name[32];
+        snprintf(name, sizeof name, "SYM%d-USDT", i);
+        names.push_back(name);
+    }
+
+    Setup::initializeFiles(names);
+    FileWriter::start();
+    Measurement::tickLogEnabled = false;
+    DataCollector::setIndicators({INDICATOR_CLOSE, INDICATOR_SMA,
+                                  INDICATOR_EMA_SHORT, INDICATOR_EMA_LONG,
+                                  INDICATOR_MACD, INDICATOR_SIGNAL,
+                                  INDICATOR_DISTANCE, INDICATOR_RSI,
+                                  INDICATOR_BOLLINGER_UPPER, INDICATOR_ATR,
+                                  INDICATOR_VWAP});
+    std::vector<int> symbols = Universe::init(names);
+
+    while (minute < (long)DataCollector::HISTORY_POINTS) {
+        runMinute(symbols, trades);
+    }
+
+    double before = nowMs();
+    checkpoint_t checkpoint;
+    Checkpoint::capture(symbols, checkpoint);
+    double captureMs = nowMs() - before;
+
+    before = nowMs();
+    bool written = Checkpoint::write(Checkpoint::path, checkpoint);
+    double writeMs = nowMs() - before;
+    checkpoint = checkpoint_t();
+
+    struct stat st;
+    if (!written || stat(Checkpoint::path.c_str(), &st) != 0) {
+        fprintf(out, "checkpoint could not be written\n");
+        return 1;
+    }
+
+    // The tick that follows, once without a restart...
+    long checkpointMinute = minute;
+    runMinute(symbols, trades);
+    std::vector<double> expected = lastPoints(symbols);
+
+    // ...and once after dropping everything and restoring the checkpoint
+    clearAll(symbols);
+    minute = checkpointMinute;
+
+    before = nowMs();
+    checkpoint_t restored;
+    bool readOk = Checkpoint::read(Checkpoint::path, restored);
+    double readMs = nowMs() - before;
+
+    before = nowMs();
+    checkpoint_stats_t stats = Checkpoint::restore(restored);
+    double restoreMs = nowMs() - before;
+
+    runMinute(symbols, trades);
+    std::vector<double> actual = lastPoints(symbols);
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        mismatches += expected[i] != actual[i];
+    }
+
+    // Restarts after a gap, up to where the checkpoint has to be refused.
+    // Accepted ones run until the longest window has slid past the gap.
+    const long maxAgeMinutes = Checkpoint::maxAgeMs() / 60000;
+    const long gaps[] = {10, maxAgeMinutes - 1, maxAgeMinutes + 60};
+    const long slide = IndicatorEngine::lookbackBars(INDICATOR_CLOSE) *
+                       IndicatorEngine::barMs() / 60000;
+    bool gapsOk = true;
+    char gapResults[3][64];
+    for (int g = 0; g < 3; g++) {
+        clearAll(symbols);
+        minute = checkpointMinute + gaps[g];
+        Clock::setVirtualTime(START + minute * 60000);
+        checkpoint_t late;
+        bool accepted = Checkpoint::read(Checkpoint::path, late);
+        bool expectAccepted = gaps[g] * 60000 <= Checkpoint::maxAgeMs();
+
+        double error = 0;
+        if (accepted) {
+            Checkpoint::restore(late);
+            for (long m = 0; m < slide + 5; m++) {
+                runMinute(symbols, trades);
+            }
+            error = smaError(symbols);
+        }
+        bool ok = accepted == expectAccepted && error < 1e-9;
+        gapsOk &= ok;
+        snprintf(gapResults[g], sizeof gapResults[g], "%s, sma err %.2e%s",
+                 accepted ? "restored" : "refused", error,
+                 ok ? "" : "  WRONG");
+    }
+
+    FileWriter::stop();
+
+    fprintf(out, "symbols: %d, trades per minute: %d\n", numSymbols, trades);
+    fprintf(out, "checkpoint   %8.1f MB  (%zu series, %zu trades)\n",
+            st.st_size / 1e6, stats.indicators, stats.measurements);
+    fprintf(out, "capture      %8.1f ms\n", captureMs);
+    fprintf(out, "write        %8.1f ms  (with fsync)\n", writeMs);
+    fprintf(out, "read         %8.1f ms\n", readMs);
+    fprintf(out, "restore      %8.1f ms\n", restoreMs);
+    fprintf(out, "next tick    %s\n",
+            readOk && mismatches == 0 ? "identical" : "DIFFERENT");
+    for (int g = 0; g < 3; g++) {
+        fprintf(out, "gap %5ld min %s\n", gaps[g], gapResults[g]);
+    }
+    fprintf(out, "scratch directory: %s\n", directory);
+    fclose(out);
+
+    return readOk && mismatches == 0 && gapsOk ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+// Checks every correlation kernel this CPU runs, and the FFT scan, against
+// the scalar kernel and times a Pearson lag scan with each.
+//
+//   ./bench/correlation_bench [points] [window] [scans]
+//
+// The scan correlates one window against every window of a 3 day averages
+// series, like calculateAllPearson does for each pair of symbols. Normalizing
+// and transforming the series and the window is not timed, a run does it once
+// per symbol. Where the FFT row overtakes the active kernel is where
+// FFT_MIN_WORK in pearson.cpp belongs.
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "pearson/correlation_kernels.hpp"
+#include "pearson/fft.hpp"
+#include "pearson/pearson.hpp"
+
+static double nowNs() {
+    return std::chrono::duration<double, std::nano>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// A random walk around a price level with a flat stretch, like a quiet
+// market
+static std::vector<double> prices(size_t n, double level, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> step(0, level * 1e-4);
+    std::vector<double> values(n);
+    double price = level;
+    for (size_t i = 0; i < n; i++) {
+        if (i % 500 >= 400) {
+            values[i] = price;
+            continue;
+        }
+        price += step(generator);
+        values[i] = price;
+    }
+    return values;
+}
+
+// How far a differs from the scalar b, relative to the size of the terms
+static double error(double a, double b, double scale) {
+    return std::fabs(a - b) / (scale > 0 ? scale : 1);
+}
+
+// Worst error of kernels against scalar over every length up to maxLength,
+// so all tails are covered
+static double checkReductions(const correlation_kernels_t& kernels,
+                              const correlation_kernels_t& scalar,
+                              const std::vector<double>& x,
+                              const std::vector<double>& y,
+                              size_t maxLength) {
+    double worst = 0;
+    for (size_t n = 0; n <= maxLength; n++) {
+        double scale = 0;
+        for (size_t i = 0; i < n; i++) {
+            scale += std::fabs(x[i]) + std::fabs(x[i] * (y[i + 16] - y[0]));
+        }
+
+        worst = std::max(worst, error(kernels.sum(x.data(), n),
+                                      scalar.sum(x.data(), n), scale));
+        // n lags of a window of up to 16 points, n lags of y follow it
+        size_t window = n % 17;
+        double actualDots[67], expectedDots[67];
+        kernels.dots(x.data(), window, y.data(), y[0], n, actualDots);
+        scalar.dots(x.data(), window, y.data(), y[0], n, expectedDots);
+        for (size_t k = 0; k < n; k++) {
+            worst = std::max(worst, error(actualDots[k], expectedDots[k],
+                                          scale));
+        }
+
+        double xMean = n > 0 ? scalar.sum(x.data(), n) / n : 0;
+        double yMean = n > 0 ? scalar.sum(y.data(), n) / n : 0;
+        double actual[3], expected[3];
+        kernels.moments(x.data(), xMean, y.data(), yMean, n, actual);
+        scalar.moments(x.data(), xMean, y.data(), yMean, n, expected);
+        double squares = std::fabs(expected[1]) + std::fabs(expected[2]);
+        for (int m = 0; m < 3; m++) {
+            worst = std::max(worst, error(actual[m], expected[m], squares));
+        }
+
+        // Butterflies over x's points, which stay near 1 like the FFT's
+        std::vector<double> a(4 * n), cosines(n), sines(n);
+        for (size_t i = 0; i < 4 * n; i++) {
+            a[i] = x[i % x.size()];
+        }
+        for (size_t k = 0; k < n; k++) {
+            cosines[k] = std::cos(k * 0.1);
+            sines[k] = std::sin(k * 0.1);
+        }
+        std::vector<double> b(a);
+        kernels.butterflies(&a[0], &a[n], &a[2 * n], &a[3 * n], cosines.data(),
+                            sines.data(), n);
+        scalar.butterflies(&b[0], &b[n], &b[2 * n], &b[3 * n], cosines.data(),
+                           sines.data(), n);
+        for (size_t i = 0; i < 4 * n; i++) {
+            worst = std::max(worst, error(a[i], b[i], 1));
+        }
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    const size_t points = argc > 1 ? atoi(argv[1]) : 4320;
+    const size_t window = argc > 2 ? atoi(argv[2]) : 8;
+    const int scans = argc > 3 ? atoi(argv[3]) : 500;
+
+    if (window < 2 || points < window + 16 || scans < 1) {
+        fprintf(stderr, "usage: %s [points] [window] [scans]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<double> y = prices(points, 60000, 1);
+    std::vector<double> x = prices(window, 3000, 2);
+    std::vector<double> noise = prices(points, 1, 3);
+
+    std::vector<const correlation_kernels_t*> kernels =
+        CorrelationKernels::available();
+    const correlation_kernels_t& scalar = *kernels[0];
+    const char* picked = CorrelationKernels::active().name;
+
+    // The history's normalization is shared by every window scanned over it
+    pearson_window_t normalized;
+    Pearson::normalizeWindow(x.data(), window, normalized);
+    pearson_lags_t history;
+    Pearson::normalizeLags(y.data(), points, window, history);
+    const size_t lags = points - window + 1;
+
+    CorrelationKernels::select(scalar.name);
+    std::vector<double> expected(lags);
+    Pearson::scanLags(normalized, y.data(), history, lags, expected.data());
+
+    printf("points: %zu, window: %zu, scans: %d, active kernel: %s, %s\n",
+           points, window, scans, picked,
+           Pearson::prefersFft(points, window) ? "fft preferred"
+                                               : "kernels preferred");
+    printf("%8s %14s %14s %12s %9s\n", "kernel", "reduction err",
+           "pearson err", "ns/lag", "speedup");
+
+    bool ok = true;
+    double scalarNs = 0;
+    std::vector<double> actual(lags);
+    for (const correlation_kernels_t* k : kernels) {
+        CorrelationKernels::select(k->name);
+
+        double reductionError = checkReductions(
+            *k, scalar, noise, y, std::min(points - 16, (size_t)67));
+
+        // The whole lag scan and the old slice-by-slice formula
+        Pearson::scanLags(normalized, y.data(), history, lags, actual.data());
+        double pearsonError = 0;
+        for (size_t i = 0; i < lags; i++) {
+            pearsonError =
+                std::max(pearsonError, std::fabs(actual[i] - expected[i]));
+        }
+        std::vector<double> slice(y.end() - window, y.end());
+        pearsonError = std::max(
+            pearsonError, std::fabs(Pearson::calculatePearson(x, slice) -
+                                    actual[lags - 1]));
+
+        double start = nowNs();
+        for (int s = 0; s < scans; s++) {
+            Pearson::scanLags(normalized, y.data(), history, lags,
+                              actual.data());
+        }
+        double ns = (nowNs() - start) / scans / lags;
+        if (k == &scalar) {
+            scalarNs = ns;
+        }
+
+        bool passed = reductionError < 1e-12 && pearsonError < 1e-9;
+        ok &= passed;
+        printf("%8s %14.2e %14.2e %12.2f %8.2fx%s\n", k->name, reductionError,
+               pearsonError, ns, scalarNs / ns, passed ? "" : "  MISMATCH");
+    }
+
+    // The FFT scan, its rounding against the series' whole spread
+    CorrelationKernels::select(picked);
+    fft_plan_t plan;
+    Fft::plan(Fft::sizeFor(points), plan);
+    fft_spectrum_t product;
+    Pearson::transformWindow(plan, normalized);
+    Pearson::transformLags(plan, y.data(), points, history);
+    actual.resize(plan.size);
+    Pearson::scanLagsFft(normalized, y.data(), history, lags, plan, product,
+                         actual.data());
+    double fftError = 0;
+    for (size_t i = 0; i < lags; i++) {
+        fftError = std::max(fftError, std::fabs(actual[i] - expected[i]));
+    }
+
+    double start = nowNs();
+    for (int s = 0; s < scans; s++) {
+        Pearson::scanLagsFft(normalized, y.data(), history, lags, plan,
+                             product, actual.data());
+    }
+    double ns = (nowNs() - start) / scans / lags;
+    bool passed = fftError < 1e-9;
+    ok &= passed;
+    printf("%8s %14s %14.2e %12.2f %8.2fx%s\n", "fft", "-", fftError, ns,
+           scalarNs / ns, passed ? "" : "  MISMATCH");
+
+    return ok ? 0 : 1;
+}
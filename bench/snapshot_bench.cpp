@@ -0,0 +1,188 @@
+// Measures how long the indicator tick takes while reader threads copy
+// full series the way the HTTP handlers do, at increasing request rates.
+//
+//   ./bench/snapshot_bench [symbols] [ticks per rate] [reader threads]
+//
+// The rings are filled with 3 days of minutes first, so every read copies
+// the full 4320 points. Everything is written to a scratch directory under
+// /tmp.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "data_collector/data_collector.hpp"
+#include "measurement/measurement.hpp"
+#include "universe/universe.hpp"
+#include "utils/clock.hpp"
+#include "utils/file_writer.hpp"
+#include "utils/setup.hpp"
+
+typedef struct {
+    std::vector<int>* symbols;
+    double rate;  // Requests per second for this thread, 0 = unthrottled
+    std::atomic<bool>* running;
+    unsigned long requests;
+} reader_args_t;
+
+static const long START = 1752508800000;  // Minute aligned
+static const long TICK_SPACING_US = 5000;
+static long minute = 0;
+
+static double nowSeconds() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// One trade per symbol, then the minute tick on top of it
+static void runMinute(const std::vector<int>& symbols) {
+    long timestamp = START + minute * 60000;
+    Clock::setVirtualTime(timestamp);
+    for (size_t i = 0; i < symbols.size(); i++) {
+        double px = 100.0 + i + (minute % 60) * 0.01;
+        Measurement::storeMeasurement(
+            symbols[i], Measurement::create(px, 1.0, timestamp - 1000));
+    }
+
+    DataCollector::runTick(symbols, timestamp);
+    minute++;
+}
+
+static void* readerThread(void* arg) {
+    reader_args_t* args = (reader_args_t*)arg;
+    const std::vector<int>& symbols = *args->symbols;
+    double interval = args->rate > 0 ? 1.0 / args->rate : 0;
+    double next = nowSeconds();
+    size_t i = 0;
+
+    while (*args->running) {
+        // Like /sma?window=4320: copy the whole series of one symbol
+        value_t averages = DataCollector::getRecent(
+            INDICATOR_SMA, symbols[i++ % symbols.size()]);
+        if (averages.values.empty()) {
+            continue;
+        }
+        args->requests++;
+
+        if (interval > 0) {
+            next += interval;
+            double wait = next - nowSeconds();
+            if (wait > 0) {
+                usleep(wait * 1e6);
+            }
+        }
+    }
+
+    return nullptr;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[(size_t)(p * (values.size() - 1))];
+}
+
+int main(int argc, char** argv) {
+    const int numSymbols = argc > 1 ? atoi(argv[1]) : 50;
+    const int ticks = argc > 2 ? atoi(argv[2]) : 200;
+    const int numReaders = argc > 3 ? atoi(argv[3]) : 4;
+    const double rates[] = {0, 1000, 10000, 50000, -1};  // -1 = unthrottled
+
+    if (numSymbols < 1 || numSymbols > MAX_SYMBOLS || ticks < 1 ||
+        numReaders < 1) {
+        fprintf(stderr, "usage: %s [symbols] [ticks] [reader threads]\n",
+                argv[0]);
+        return 1;
+    }
+
+    char directory[] = "/tmp/snapshot_bench.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+        perror("scratch directory");
+        return 1;
+    }
+
+    // Setup logs on stdout, keep that out of the results
+    FILE* out = fdopen(dup(STDOUT_FILENO), "w");
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    std::vector<std::string> names;
+    for (int i = 0; i < numSymbols; i++) {
+        char name[32];
+        snprintf(name, sizeof name, "SYM%d-USDT", i);
+        names.push_back(name);
+    }
+
+    Setup::initializeFiles(names);
+    FileWriter::start();
+    Measurement::tickLogEnabled = false;
+    std::vector<int> symbols = Universe::init(names);
+
+    while (minute < (long)DataCollector::seriesCapacity(INDICATOR_SMA)) {
+        runMinute(symbols);
+    }
+
+    fprintf(out, "symbols: %d, ticks per rate: %d, reader threads: %d\n",
+            numSymbols, ticks, numReaders);
+    fprintf(out, "%12s %12s %10s %10s %10s\n", "target req/s", "req/s",
+            "tick p50", "tick p99", "tick max");
+
+    for (double rate : rates) {
+        std::atomic<bool> running(true);
+        std::vector<reader_args_t> args(numReaders);
+        std::vector<pthread_t> readers(rate != 0 ? numReaders : 0);
+
+        for (size_t r = 0; r < readers.size(); r++) {
+            args[r].symbols = &symbols;
+            args[r].rate = rate > 0 ? rate / numReaders : 0;
+            args[r].running = &running;
+            args[r].requests = 0;
+            pthread_create(&readers[r], nullptr, readerThread, &args[r]);
+        }
+
+        std::vector<double> latencies;
+        double start = nowSeconds();
+        for (int t = 0; t < ticks; t++) {
+            double before = nowSeconds();
+            runMinute(symbols);
+            latencies.push_back((nowSeconds() - before) * 1e3);
+
+            // Let the readers run between ticks, as they would for a minute
+            usleep(TICK_SPACING_US);
+        }
+        double seconds = nowSeconds() - start;
+
+        running = false;
+        unsigned long requests = 0;
+        for (size_t r = 0; r < readers.size(); r++) {
+            pthread_join(readers[r], nullptr);
+            requests += args[r].requests;
+        }
+
+        char target[32];
+        if (rate < 0) {
+            snprintf(target, sizeof target, "max");
+        } else {
+            snprintf(target, sizeof target, "%.0f", rate);
+        }
+        fprintf(out, "%12s %12.0f %8.2fms %8.2fms %8.2fms\n", target,
+                requests / seconds, percentile(latencies, 0.5),
+                percentile(latencies, 0.99), percentile(latencies, 1.0));
+    }
+
+    FileWriter::stop();
+    fprintf(out, "scratch directory: %s\n", directory);
+    fclose(out);
+
+    return 0;
+}
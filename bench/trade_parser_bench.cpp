@@ -0,0 +1,114 @@
+// Compares the generic nlohmann::json path against TradeParser::parseTrades
+// on frames recorded from the OKX trades channel.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+
+#include "websocket/trade_parser.hpp"
+
+static const char* FRAMES[] = {
+    "{\"arg\":{\"channel\":\"trades\",\"instId\":\"BTC-USDT\"},\"data\":[{"
+    "\"instId\":\"BTC-USDT\",\"tradeId\":\"752359631\",\"px\":\"117952.1\","
+    "\"sz\":\"0.00010926\",\"side\":\"buy\",\"ts\":\"1752508800131\","
+    "\"count\":\"1\",\"source\":\"0\",\"seqId\":57384310427}]}",
+    "{\"arg\":{\"channel\":\"trades\",\"instId\":\"ETH-USDT\"},\"data\":[{"
+    "\"instId\":\"ETH-USDT\",\"tradeId\":\"654982311\",\"px\":\"2987.45\","
+    "\"sz\":\"0.154881\",\"side\":\"sell\",\"ts\":\"1752508800217\","
+    "\"count\":\"2\",\"source\":\"0\",\"seqId\":41930188254}]}",
+    "{\"arg\":{\"channel\":\"trades\",\"instId\":\"DOGE-USDT\"},\"data\":[{"
+    "\"instId\":\"DOGE-USDT\",\"tradeId\":\"381276540\",\"px\":\"0.20051\","
+    "\"sz\":\"1496.417655\",\"side\":\"buy\",\"ts\":\"1752508800402\","
+    "\"count\":\"1\",\"source\":\"0\",\"seqId\":20384710932},{\"instId\":"
+    "\"DOGE-USDT\",\"tradeId\":\"381276541\",\"px\":\"0.20052\",\"sz\":"
+    "\"250\",\"side\":\"buy\",\"ts\":\"1752508800402\",\"count\":\"1\","
+    "\"source\":\"0\",\"seqId\":20384710933},{\"instId\":\"DOGE-USDT\","
+    "\"tradeId\":\"381276542\",\"px\":\"0.20053\",\"sz\":\"9.871\",\"side\":"
+    "\"buy\",\"ts\":\"1752508800403\",\"count\":\"1\",\"source\":\"0\","
+    "\"seqId\":20384710934}]}",
+    "{\"arg\":{\"channel\":\"trades\",\"instId\":\"SOL-USDT\"},\"data\":[{"
+    "\"instId\":\"SOL-USDT\",\"tradeId\":\"412598702\",\"px\":\"162.38\","
+    "\"sz\":\"3.2197\",\"side\":\"sell\",\"ts\":\"1752508800655\","
+    "\"count\":\"4\",\"source\":\"0\",\"seqId\":33018277165},{\"instId\":"
+    "\"SOL-USDT\",\"tradeId\":\"412598703\",\"px\":\"162.37\",\"sz\":"
+    "\"0.5\",\"side\":\"sell\",\"ts\":\"1752508800655\",\"count\":\"1\","
+    "\"source\":\"0\",\"seqId\":33018277166}]}",
+};
+static const int NUM_FRAMES = sizeof FRAMES / sizeof FRAMES[0];
+
+struct checksum_t {
+    double px;
+    double sz;
+    long ts;
+    long trades;
+};
+
+static void accumulate(const char* instId, size_t instIdLen,
+                       const measurement_t& m, void* user) {
+    checksum_t* sum = (checksum_t*)user;
+    sum->px += m.px;
+    sum->sz += m.sz;
+    sum->ts += m.ts;
+    sum->trades++;
+}
+
+static void parseGeneric(const char* frame, checksum_t& sum) {
+    nlohmann::json response = nlohmann::json::parse(frame);
+    for (const nlohmann::json& trade : response["data"]) {
+        std::string instId = trade["instId"];
+        sum.px += std::stod(trade["px"].get<std::string>());
+        sum.sz += std::stod(trade["sz"].get<std::string>());
+        sum.ts += std::stol(trade["ts"].get<std::string>());
+        sum.trades++;
+    }
+}
+
+static void parseFast(const char* frame, size_t len, checksum_t& sum) {
+    TradeParser::parseTrades(frame, len, accumulate, &sum);
+}
+
+int main(int argc, char** argv) {
+    const long iterations = argc > 1 ? atol(argv[1]) : 200000;
+
+    std::vector<size_t> lengths;
+    for (int i = 0; i < NUM_FRAMES; i++) {
+        lengths.push_back(strlen(FRAMES[i]));
+    }
+
+    checksum_t generic = {0, 0, 0, 0};
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        parseGeneric(FRAMES[i % NUM_FRAMES], generic);
+    }
+    double genericSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    checksum_t fast = {0, 0, 0, 0};
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) {
+        parseFast(FRAMES[i % NUM_FRAMES], lengths[i % NUM_FRAMES], fast);
+    }
+    double fastSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count();
+
+    printf("frames: %ld, trades: %ld\n", iterations, generic.trades);
+    printf("nlohmann::json  %12.0f msg/s\n", iterations / genericSeconds);
+    printf("TradeParser     %12.0f msg/s  (%.1fx)\n", iterations / fastSeconds,
+           genericSeconds / fastSeconds);
+
+    bool match = generic.trades == fast.trades && generic.ts == fast.ts &&
+                 std::fabs(generic.px - fast.px) <= 1e-9 * generic.px &&
+                 std::fabs(generic.sz - fast.sz) <= 1e-9 * generic.sz;
+    if (!match) {
+        fprintf(stderr, "checksum mismatch between parsers\n");
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Runs the storage and bar-tick pipeline on synthetic trades for a given
+// number of symbols and reports resident memory and CPU per trade/minute.
+//
+//   ./bench/universe_bench <symbols> [minutes] [trades per symbol per second]
+//                          [worker threads, 0 = one per core]
+//                          [bar interval in seconds]
+//                          [Pearson window in minutes]
+//
+// Run once per universe size, memory is per process. Everything is written
+// to a scratch directory under /tmp.
+
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "data_collector/data_collector.hpp"
+#include "measurement/measurement.hpp"
+#include "pearson/pearson.hpp"
+#include "scheduler/scheduler.hpp"
+#include "universe/universe.hpp"
+#include "utils/clock.hpp"
+#include "utils/file_writer.hpp"
+#include "utils/setup.hpp"
+#include "utils/worker_pool.hpp"
+
+static double cpuSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double wallSeconds() {
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// VmRSS of this process in kB
+static long residentKb() {
+    FILE* fp = fopen("/proc/self/status", "r");
+    if (fp == NULL) {
+        return -1;
+    }
+
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof line, fp)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            kb = atol(line + 6);
+            break;
+        }
+    }
+    fclose(fp);
+    return kb;
+}
+
+int main(int argc, char** argv) {
+    const int numSymbols = argc > 1 ? atoi(argv[1]) : 8;
+    const int minutes = argc > 2 ? atoi(argv[2]) : 30;
+    const int tradesPerSecond = argc > 3 ? atoi(argv[3]) : 2;
+    const int threads = argc > 4 ? atoi(argv[4]) : 1;
+    const long barMs = (argc > 5 ? atol(argv[5]) : 60) * 1000;
+    const long pearsonWindowMs =
+        argc > 6 ? atol(argv[6]) * 60000 : Pearson::windowMs();
+
+    if (numSymbols < 1 || numSymbols > MAX_SYMBOLS || minutes < 1 ||
+        tradesPerSecond < 1 || threads < 0 ||
+        !DataCollector::setBarInterval(barMs) ||
+        minutes * 60000L % barMs != 0 || !Pearson::setWindow(pearsonWindowMs)) {
+        fprintf(stderr,
+                "usage: %s <1..%d symbols> [minutes] [trades/s] [threads] "
+                "[bar seconds] [Pearson minutes]\n",
+                argv[0], MAX_SYMBOLS);
+        return 1;
+    }
+
+    char directory[] = "/tmp/universe_bench.XXXXXX";
+    if (mkdtemp(directory) == NULL || chdir(directory) != 0) {
+        perror("scratch directory");
+        return 1;
+    }
+
+    long baselineKb = residentKb();
+
+    std::vector<std::string> names;
+    for (int i = 0; i < numSymbols; i++) {
+        char name[32];
+        snprintf(name, sizeof name, "SYM%d-USDT", i);
+        names.push_back(name);
+    }
+
+    Setup::initializeFiles(names);
+    FileWriter::start();
+    WorkerPool::start(threads);
+    std::vector<int> symbols = Universe::init(names);
+
+    // Deterministic random walk per symbol, interleaved like a live feed
+    std::vector<double> prices(numSymbols, 100.0);
+    unsigned int seed = 42;
+
+    const long start = 1752508800000;  // Minute aligned
+    const long stepMs = 1000 / tradesPerSecond;
+    const long bars = minutes * 60000L / barMs;
+    long trades = 0;
+    double storeCpu = 0;
+    double tickCpu = 0;
+    double tickWall = 0;
+
+    for (long bar = 0; bar < bars; bar++) {
+        long barStart = start + bar * barMs;
+
+        double before = cpuSeconds();
+        for (long t = barStart; t < barStart + barMs; t += stepMs) {
+            Clock::setVirtualTime(t);
+            for (int i = 0; i < numSymbols; i++) {
+                prices[i] *= 1.0 + ((double)rand_r(&seed) / RAND_MAX - 0.5) *
+                                       1e-3;
+                tick_t tick;
+                tick.m = Measurement::create(prices[i], 0.5, t);
+                tick.symbol = symbols[i];
+                tick.parsedAt = 0;
+                Measurement::storeBatch(&tick, 1);
+                trades++;
+            }
+        }
+        storeCpu += cpuSeconds() - before;
+
+        // The same sequence the scheduler and replay run every bar
+        long timestamp = barStart + barMs;
+        before = cpuSeconds();
+        double wallBefore = wallSeconds();
+        Clock::setVirtualTime(timestamp);
+        if (Scheduler::isMinuteTick(timestamp)) {
+            Scheduler::cleanup(timestamp);
+        }
+        DataCollector::runTick(symbols, timestamp);
+        if (Scheduler::isMinuteTick(timestamp)) {
+            Pearson::runTick(symbols, timestamp);
+        }
+        tickCpu += cpuSeconds() - before;
+        tickWall += wallSeconds() - wallBefore;
+    }
+
+    long residentAfterKb = residentKb();
+    int poolThreads = WorkerPool::threads();
+    WorkerPool::stop();
+    FileWriter::stop();
+
+    printf("symbols: %d, minutes: %d, trades: %ld, threads: %d, bar: %ld s, "
+           "Pearson window: %ld min\n",
+           numSymbols, minutes, trades, poolThreads, barMs / 1000,
+           pearsonWindowMs / 60000);
+    printf("resident        %8ld kB  (%ld kB over baseline, %.1f kB/symbol)\n",
+           residentAfterKb, residentAfterKb - baselineKb,
+           (double)(residentAfterKb - baselineKb) / numSymbols);
+    printf("store           %8.2f us/trade\n", storeCpu * 1e6 / trades);
+    printf("ticks           %8.2f ms/minute  (%.3f ms/symbol)\n",
+           tickCpu * 1e3 / minutes, tickCpu * 1e3 / minutes / numSymbols);
+    printf("ticks           %8.2f ms/minute wall clock\n",
+           tickWall * 1e3 / minutes);
+    printf("bar tick        %8.3f ms/bar wall clock\n", tickWall * 1e3 / bars);
+    printf("scratch directory: %s\n", directory);
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+#include "bars.hpp"
+
+#include <pthread.h>
+
+#include <deque>
+
+#include "../universe/universe.hpp"
+
+const long Bars::RESOLUTION_MS[BAR_RESOLUTION_COUNT] = {1000, 60 * 1000,
+                                                        5 * 60 * 1000,
+                                                        60 * 60 * 1000};
+const char* const Bars::RESOLUTION_NAMES[BAR_RESOLUTION_COUNT] = {"1s", "1m",
+                                                                  "5m", "1h"};
+const size_t Bars::HISTORY_LENGTH = 120;
+
+typedef struct {
+    bar_t current;
+    bool hasCurrent;
+    long sealedUntil;  // End of the last sealed bar
+    std::deque<bar_t> sealed;
+} bar_series_t;
+
+static bar_series_t series[MAX_SYMBOLS][BAR_RESOLUTION_COUNT];
+static pthread_mutex_t barsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Caller holds barsMutex
+static void seal(bar_series_t& s, long resolutionMs) {
+    if (s.sealed.size() >= Bars::HISTORY_LENGTH) {
+        s.sealed.pop_front();
+    }
+    s.sealed.push_back(s.current);
+    s.sealedUntil = s.current.start + resolutionMs;
+    s.hasCurrent = false;
+}
+
+// Seals the current bar once time has moved past its end, caller holds
+// barsMutex
+static void sealUntil(bar_series_t& s, long resolutionMs, long timestamp) {
+    if (s.hasCurrent && timestamp >= s.current.start + resolutionMs) {
+        seal(s, resolutionMs);
+    }
+}
+
+static void fold(int symbol, const measurement_t& m) {
+    for (int r = 0; r < BAR_RESOLUTION_COUNT; r++) {
+        bar_series_t& s = series[symbol][r];
+        const long resolutionMs = Bars::RESOLUTION_MS[r];
+
+        sealUntil(s, resolutionMs, m.ts);
+
+        if (!s.hasCurrent) {
+            long start = m.ts - m.ts % resolutionMs;
+            if (start < s.sealedUntil) {
+                start = s.sealedUntil;  // Late trade, never reopen a bar
+            }
+
+            bar_t bar = {start, m.px, m.px, m.px, m.px, 0, 0, 0};
+            s.current = bar;
+            s.hasCurrent = true;
+        }
+
+        bar_t& bar = s.current;
+        if (m.px > bar.high) {
+            bar.high = m.px;
+        }
+        if (m.px < bar.low) {
+            bar.low = m.px;
+        }
+        bar.close = m.px;
+        bar.volume += m.sz;
+        bar.notional += m.px * m.sz;
+        bar.trades++;
+    }
+}
+
+void Bars::update(int symbol, const measurement_t& m) {
+    pthread_mutex_lock(&barsMutex);
+    fold(symbol, m);
+    pthread_mutex_unlock(&barsMutex);
+}
+
+void Bars::updateBatch(const tick_t* ticks, size_t count) {
+    // One lock acquisition for the whole batch, skipping symbols
+    // unsubscribed since the trades were queued as Measurement does
+    pthread_mutex_lock(&barsMutex);
+    for (size_t i = 0; i < count; i++) {
+        if (Universe::isActive(ticks[i].symbol)) {
+            fold(ticks[i].symbol, ticks[i].m);
+        }
+    }
+    pthread_mutex_unlock(&barsMutex);
+}
+
+bool Bars::getSealedBar(int symbol, bar_resolution_t resolution, long end,
+                        bar_t& out) {
+    const long start = end - RESOLUTION_MS[resolution];
+    bool found = false;
+
+    pthread_mutex_lock(&barsMutex);
+    bar_series_t& s = series[symbol][resolution];
+    sealUntil(s, RESOLUTION_MS[resolution], end);
+
+    // Usually the newest sealed bar, unless trades already sealed later ones
+    for (std::deque<bar_t>::reverse_iterator it = s.sealed.rbegin();
+         it != s.sealed.rend() && it->start >= start; ++it) {
+        if (it->start == start) {
+            out = *it;
+            found = true;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&barsMutex);
+
+    return found;
+}
+
+// The coarsest resolution spanMs is a whole number of, -1 if none
+static int spanResolution(long spanMs) {
+    for (int r = BAR_RESOLUTION_COUNT - 1; r >= 0; r--) {
+        if (spanMs >= Bars::RESOLUTION_MS[r] &&
+            spanMs % Bars::RESOLUTION_MS[r] == 0) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+bool Bars::canSpan(long spanMs) {
+    int r = spanResolution(spanMs);
+    return r >= 0 && (size_t)(spanMs / RESOLUTION_MS[r]) <= HISTORY_LENGTH;
+}
+
+bool Bars::getSealedSpan(int symbol, long spanMs, long end, bar_t& out) {
+    const int r = spanResolution(spanMs);
+    if (r < 0) {
+        return false;
+    }
+    if (spanMs == RESOLUTION_MS[r]) {
+        return getSealedBar(symbol, (bar_resolution_t)r, end, out);
+    }
+
+    const long start = end - spanMs;
+    bool found = false;
+
+    pthread_mutex_lock(&barsMutex);
+    bar_series_t& s = series[symbol][r];
+    sealUntil(s, RESOLUTION_MS[r], end);
+
+    // Back to the first bar of the span, then merged oldest first
+    std::deque<bar_t>::iterator first = s.sealed.end();
+    while (first != s.sealed.begin() && (first - 1)->start >= start) {
+        --first;
+    }
+    for (std::deque<bar_t>::iterator it = first;
+         it != s.sealed.end() && it->start < end; ++it) {
+        if (!found) {
+            out = *it;
+            out.start = start;
+            found = true;
+            continue;
+        }
+        if (it->high > out.high) {
+            out.high = it->high;
+        }
+        if (it->low < out.low) {
+            out.low = it->low;
+        }
+        out.close = it->close;
+        out.volume += it->volume;
+        out.notional += it->notional;
+        out.trades += it->trades;
+    }
+    pthread_mutex_unlock(&barsMutex);
+
+    return found;
+}
+
+std::vector<bar_t> Bars::getRecentBars(int symbol, bar_resolution_t resolution,
+                                       long now, size_t count) {
+    std::vector<bar_t> result;
+
+    pthread_mutex_lock(&barsMutex);
+    bar_series_t& s = series[symbol][resolution];
+    sealUntil(s, RESOLUTION_MS[resolution], now);
+
+    size_t first = s.sealed.size() > count ? s.sealed.size() - count : 0;
+    result.assign(s.sealed.begin() + first, s.sealed.end());
+    pthread_mutex_unlock(&barsMutex);
+
+    return result;
+}
+
+double Bars::vwap(const bar_t& bar) {
+    return bar.volume > 0 ? bar.notional / bar.volume : bar.close;
+}
+
+int Bars::parseResolution(const std::string& name) {
+    for (int r = 0; r < BAR_RESOLUTION_COUNT; r++) {
+        if (name == RESOLUTION_NAMES[r]) {
+            return r;
+        }
+    }
+    return -1;
+}
+
+void Bars::clearSymbol(int symbol) {
+    pthread_mutex_lock(&barsMutex);
+    for (int r = 0; r < BAR_RESOLUTION_COUNT; r++) {
+        bar_series_t& s = series[symbol][r];
+        s.hasCurrent = false;
+        s.sealedUntil = 0;
+        std::deque<bar_t>().swap(s.sealed);
+    }
+    pthread_mutex_unlock(&barsMutex);
+}
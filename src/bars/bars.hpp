@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../measurement/measurement.hpp"
+
+typedef enum {
+    BAR_1S,
+    BAR_1M,
+    BAR_5M,
+    BAR_1H,
+    BAR_RESOLUTION_COUNT
+} bar_resolution_t;
+
+// One OHLCV bar covering [start, start + resolution)
+typedef struct {
+    long start;
+    double open;
+    double high;
+    double low;
+    double close;
+    double volume;    // Sum of trade sizes
+    double notional;  // Sum of px * sz, vwap = notional / volume
+    long trades;
+} bar_t;
+
+// Incremental bar aggregation, fed with every stored trade. Bars are
+// bucketed by exchange timestamp and only exist for periods with trades.
+namespace Bars {
+
+extern const long RESOLUTION_MS[BAR_RESOLUTION_COUNT];
+extern const char* const RESOLUTION_NAMES[BAR_RESOLUTION_COUNT];
+extern const size_t HISTORY_LENGTH;  // Sealed bars kept per resolution
+
+// Folds trades into the current bar of every resolution, sealing bars whose
+// period has ended. Trades older than the last sealed bar go into the next.
+void update(int symbol, const measurement_t& m);
+void updateBatch(const tick_t* ticks, size_t count);  // Active symbols only
+
+// The sealed bar covering [end - resolution, end), sealing it first if no
+// later trade has done so yet. False if the period had no trades.
+bool getSealedBar(int symbol, bar_resolution_t resolution, long end,
+                  bar_t& out);
+
+// The bar covering [end - spanMs, end), merged from the sealed bars of the
+// coarsest resolution that divides spanMs. False if the span had no trades.
+bool getSealedSpan(int symbol, long spanMs, long end, bar_t& out);
+// Whether spanMs is a whole number of bars of some resolution, no more than
+// HISTORY_LENGTH of them
+bool canSpan(long spanMs);
+
+// Up to the last count sealed bars ending at or before now, oldest first
+std::vector<bar_t> getRecentBars(int symbol, bar_resolution_t resolution,
+                                 long now, size_t count);
+
+double vwap(const bar_t& bar);
+int parseResolution(const std::string& name);  // -1 if unknown
+
+void clearSymbol(int symbol);
+
+}  // namespace Bars
@@ -0,0 +1,382 @@
+#include "checkpoint.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "../indicators/indicator_engine.hpp"
+#include "../universe/universe.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/setup.hpp"
+#include "../utils/symbol_registry.hpp"
+
+const uint32_t Checkpoint::VERSION = 1;
+const long Checkpoint::DEFAULT_INTERVAL_MS = 5 * 60 * 1000;  // 5 minutes
+const std::string Checkpoint::path = Setup::dataPath + "checkpoint.bin";
+
+static const char MAGIC[8] = "ECMCKPT";
+
+static pthread_t checkpointThread;
+static std::atomic<bool> running(false);
+static long interval = Checkpoint::DEFAULT_INTERVAL_MS;
+
+// Output that remembers the first error, checked once at the end
+typedef struct {
+    FILE* fp;
+    bool ok;
+} checkpoint_writer_t;
+
+static void put(checkpoint_writer_t& w, const void* data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, w.fp) != len) {
+        w.ok = false;
+    }
+}
+
+// A mapped checkpoint, read front to back
+typedef struct {
+    const char* data;
+    size_t size;
+    size_t offset;
+} checkpoint_reader_t;
+
+// Copies len bytes, false once the file runs out
+static bool take(checkpoint_reader_t& r, void* data, size_t len) {
+    if (len > r.size - r.offset) {
+        return false;
+    }
+    memcpy(data, r.data + r.offset, len);
+    r.offset += len;
+    return true;
+}
+
+// Whether timestamps are the newest ones of previous
+static bool sharesTimestamps(const std::vector<long>& timestamps,
+                             const std::vector<long>* previous) {
+    return previous != nullptr && previous->size() >= timestamps.size() &&
+           std::equal(timestamps.begin(), timestamps.end(),
+                      previous->end() - timestamps.size());
+}
+
+// fsync of the directory, without it the rename may not survive a crash
+static bool syncDirectory(const std::string& filePath) {
+    size_t slash = filePath.rfind('/');
+    std::string directory =
+        slash == std::string::npos ? "." : filePath.substr(0, slash + 1);
+
+    int fd = ::open(directory.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+void Checkpoint::capture(const std::vector<int>& symbols, checkpoint_t& out) {
+    std::vector<std::vector<indicator_snapshot_t>> indicators;
+    DataCollector::snapshot(symbols, indicators);
+
+    out.timestamp = Clock::nowMs();
+    out.barMs = IndicatorEngine::barMs();
+    out.symbols.resize(symbols.size());
+    for (size_t i = 0; i < symbols.size(); i++) {
+        symbol_checkpoint_t& symbol = out.symbols[i];
+        symbol.symbol = SymbolRegistry::name(symbols[i]);
+        symbol.indicators.swap(indicators[i]);
+        symbol.measurements = Measurement::getRecentMeasurements(
+            symbols[i], Measurement::MEASUREMENT_WINDOW_MS, out.timestamp);
+    }
+}
+
+bool Checkpoint::write(const std::string& filePath,
+                       const checkpoint_t& checkpoint) {
+    std::string temporary = filePath + ".tmp";
+    checkpoint_writer_t w = {fopen(temporary.c_str(), "wb"), true};
+    if (w.fp == nullptr) {
+        std::cerr << "Failed to create checkpoint " << temporary << ": "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    checkpoint_header_t header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, MAGIC, sizeof header.magic);
+    header.version = VERSION;
+    header.slotSize = sizeof(indicator_slot_t);
+    header.measurementSize = sizeof(measurement_t);
+    header.symbolCount = checkpoint.symbols.size();
+    header.barMs = checkpoint.barMs;
+    header.timestamp = checkpoint.timestamp;
+    put(w, &header, sizeof header);
+
+    for (const symbol_checkpoint_t& symbol : checkpoint.symbols) {
+        checkpoint_symbol_t entry;
+        memset(&entry, 0, sizeof entry);
+        strncpy(entry.symbol, symbol.symbol.c_str(), sizeof entry.symbol - 1);
+        entry.seriesCount = symbol.indicators.size();
+        entry.measurementCount = symbol.measurements.size();
+        put(w, &entry, sizeof entry);
+
+        const std::vector<long>* previous = nullptr;
+        for (const indicator_snapshot_t& indicator : symbol.indicators) {
+            const value_t& points = indicator.points;
+
+            checkpoint_series_t series;
+            memset(&series, 0, sizeof series);
+            strncpy(series.indicator,
+                    IndicatorEngine::name(indicator.indicator),
+                    sizeof series.indicator - 1);
+            series.size = points.values.size();
+            series.sharedTimestamps = sharesTimestamps(points.timestamps,
+                                                       previous);
+            series.slot = indicator.slot;
+            put(w, &series, sizeof series);
+            if (!series.sharedTimestamps) {
+                put(w, points.timestamps.data(), series.size * sizeof(long));
+            }
+            put(w, points.values.data(), series.size * sizeof(double));
+            previous = &points.timestamps;
+        }
+
+        put(w, symbol.measurements.data(),
+            symbol.measurements.size() * sizeof(measurement_t));
+    }
+
+    // The size goes in last, a torn file never has the right one
+    uint64_t size = ftell(w.fp);
+    if (fseek(w.fp, offsetof(checkpoint_header_t, size), SEEK_SET) != 0) {
+        w.ok = false;
+    }
+    put(w, &size, sizeof size);
+    w.ok &= fflush(w.fp) == 0 && fsync(fileno(w.fp)) == 0;
+    w.ok &= fclose(w.fp) == 0;
+
+    if (!w.ok || rename(temporary.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Failed to write checkpoint " << filePath << ": "
+                  << strerror(errno) << std::endl;
+        unlink(temporary.c_str());
+        return false;
+    }
+    return syncDirectory(filePath);
+}
+
+// Parses everything after the header, false if the file is inconsistent
+static bool readSymbols(checkpoint_reader_t& r, checkpoint_t& out) {
+    for (symbol_checkpoint_t& symbol : out.symbols) {
+        checkpoint_symbol_t entry;
+        if (!take(r, &entry, sizeof entry)) {
+            return false;
+        }
+        entry.symbol[sizeof entry.symbol - 1] = '\0';
+        symbol.symbol = entry.symbol;
+
+        std::vector<long> previous;
+        for (uint32_t i = 0; i < entry.seriesCount; i++) {
+            checkpoint_series_t series;
+            if (!take(r, &series, sizeof series) || series.size > r.size) {
+                return false;
+            }
+            series.indicator[sizeof series.indicator - 1] = '\0';
+
+            indicator_snapshot_t indicator;
+            indicator.slot = series.slot;
+            std::vector<long>& timestamps = indicator.points.timestamps;
+            if (series.sharedTimestamps) {
+                if (previous.size() < series.size) {
+                    return false;
+                }
+                timestamps.assign(previous.end() - series.size,
+                                  previous.end());
+            } else {
+                timestamps.resize(series.size);
+                if (!take(r, timestamps.data(), series.size * sizeof(long))) {
+                    return false;
+                }
+            }
+            indicator.points.values.resize(series.size);
+            if (!take(r, indicator.points.values.data(),
+                      series.size * sizeof(double))) {
+                return false;
+            }
+            previous = timestamps;
+
+            // Indicators this build no longer knows are dropped
+            int id = IndicatorEngine::lookup(series.indicator);
+            if (id >= 0) {
+                indicator.indicator = (indicator_t)id;
+                symbol.indicators.push_back(indicator);
+            }
+        }
+
+        if (entry.measurementCount > r.size) {
+            return false;
+        }
+        symbol.measurements.resize(entry.measurementCount);
+        if (!take(r, symbol.measurements.data(),
+                  entry.measurementCount * sizeof(measurement_t))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+long Checkpoint::maxAgeMs() {
+    // The window plus the point leaving it, of the longest sliding window
+    size_t lookback = 0;
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        lookback = std::max(lookback,
+                            IndicatorEngine::lookbackBars((indicator_t)i));
+    }
+    return DataCollector::HISTORY_MS -
+           (long)lookback * IndicatorEngine::barMs();
+}
+
+bool Checkpoint::read(const std::string& filePath, checkpoint_t& out) {
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        st.st_size < (off_t)sizeof(checkpoint_header_t)) {
+        close(fd);
+        std::cerr << "Ignoring unreadable checkpoint " << filePath
+                  << std::endl;
+        return false;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // The mapping stays valid
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    checkpoint_reader_t r = {(const char*)data, (size_t)st.st_size, 0};
+    checkpoint_header_t header;
+    take(r, &header, sizeof header);
+
+    bool ok = false;
+    if (memcmp(header.magic, MAGIC, sizeof header.magic) != 0 ||
+        header.version != VERSION || header.size != r.size ||
+        header.symbolCount > r.size / sizeof(checkpoint_symbol_t)) {
+        std::cerr << "Ignoring unreadable checkpoint " << filePath
+                  << std::endl;
+    } else if (header.slotSize != sizeof(indicator_slot_t) ||
+               header.measurementSize != sizeof(measurement_t)) {
+        std::cerr << "Ignoring checkpoint of a different build" << std::endl;
+    } else if (header.barMs != IndicatorEngine::barMs()) {
+        std::cerr << "Ignoring checkpoint taken with " << header.barMs / 1000
+                  << " s bars" << std::endl;
+    } else if (Clock::nowMs() - header.timestamp > maxAgeMs()) {
+        std::cerr << "Ignoring checkpoint older than "
+                  << maxAgeMs() / 60000 << " minutes" << std::endl;
+    } else {
+        out.timestamp = header.timestamp;
+        out.barMs = header.barMs;
+        out.symbols.assign(header.symbolCount, symbol_checkpoint_t());
+        ok = readSymbols(r, out);
+        if (!ok) {
+            std::cerr << "Ignoring inconsistent checkpoint " << filePath
+                      << std::endl;
+        }
+    }
+
+    munmap(data, st.st_size);
+    return ok;
+}
+
+checkpoint_stats_t Checkpoint::restore(const checkpoint_t& checkpoint) {
+    checkpoint_stats_t stats = {0, 0, 0, Clock::nowMs() - checkpoint.timestamp};
+
+    // Already in the tick logs, only memory is filled
+    bool tickLogEnabled = Measurement::tickLogEnabled;
+    bool textLogEnabled = Measurement::textLogEnabled;
+    Measurement::tickLogEnabled = false;
+    Measurement::textLogEnabled = false;
+
+    for (const symbol_checkpoint_t& symbol : checkpoint.symbols) {
+        int id = SymbolRegistry::lookup(symbol.symbol);
+        if (id < 0 || !Universe::isActive(id)) {
+            continue;
+        }
+
+        stats.symbols++;
+        stats.indicators += DataCollector::restore(id, symbol.indicators);
+
+        std::vector<tick_t> ticks(symbol.measurements.size());
+        for (size_t i = 0; i < ticks.size(); i++) {
+            ticks[i].m = symbol.measurements[i];
+            ticks[i].symbol = id;
+            ticks[i].parsedAt = 0;
+        }
+        Measurement::storeBatch(ticks.data(), ticks.size());
+        stats.measurements += ticks.size();
+    }
+    DataCollector::publish();
+
+    Measurement::tickLogEnabled = tickLogEnabled;
+    Measurement::textLogEnabled = textLogEnabled;
+
+    return stats;
+}
+
+static void save() {
+    auto start = std::chrono::steady_clock::now();
+
+    checkpoint_t checkpoint;
+    Checkpoint::capture(Universe::activeSymbols(), checkpoint);
+    if (!Checkpoint::write(Checkpoint::path, checkpoint)) {
+        return;
+    }
+
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+    std::cout << "Checkpoint of " << checkpoint.symbols.size()
+              << " symbols written in " << ms << " ms" << std::endl;
+}
+
+static void* checkpointThreadFunction(void* arg) {
+    long next = Clock::nowMs() + interval;
+
+    while (running) {
+        // Short steps so stop() does not wait a whole interval
+        usleep(100 * 1000);
+        if (Clock::nowMs() >= next) {
+            save();
+            next = Clock::nowMs() + interval;
+        }
+    }
+
+    return nullptr;
+}
+
+void Checkpoint::start(long intervalMs) {
+    if (running) {
+        return;
+    }
+    interval = intervalMs;
+    running = true;
+    pthread_create(&checkpointThread, nullptr, checkpointThreadFunction,
+                   nullptr);
+}
+
+void Checkpoint::stop() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    pthread_join(checkpointThread, nullptr);
+    save();
+}
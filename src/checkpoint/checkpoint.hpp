@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "../data_collector/data_collector.hpp"
+#include "../measurement/measurement.hpp"
+
+// On-disk layout of data/checkpoint.bin, in host byte order:
+//   checkpoint_header_t, then for every symbol a checkpoint_symbol_t
+//   followed by its series (each a checkpoint_series_t, size timestamps
+//   unless they are shared, and size values) and its measurements.
+// Slots and measurements are raw copies, so a checkpoint is only read back
+// by a build with the same layout.
+
+typedef struct {
+    char magic[8];  // "ECMCKPT"
+    uint32_t version;
+    uint32_t slotSize;         // sizeof(indicator_slot_t)
+    uint32_t measurementSize;  // sizeof(measurement_t)
+    uint32_t symbolCount;
+    int64_t barMs;
+    int64_t timestamp;  // When the state was captured
+    uint64_t size;      // Of the whole file, a shorter one was torn
+} checkpoint_header_t;
+
+typedef struct {
+    char symbol[40];
+    uint32_t seriesCount;
+    uint32_t measurementCount;
+} checkpoint_symbol_t;
+
+typedef struct {
+    char indicator[24];  // Registry name, ids may change between builds
+    uint64_t size;       // Points that follow
+    // The series of a symbol are appended at the same ticks. 1 if the
+    // timestamps are the newest size ones of the previous series and are
+    // left out.
+    uint32_t sharedTimestamps;
+    uint32_t reserved;
+    indicator_slot_t slot;
+} checkpoint_series_t;
+
+// Everything a symbol needs to carry on where it stopped
+typedef struct {
+    std::string symbol;
+    std::vector<indicator_snapshot_t> indicators;
+    std::vector<measurement_t> measurements;  // The measurement window
+} symbol_checkpoint_t;
+
+typedef struct {
+    long timestamp;
+    long barMs;
+    std::vector<symbol_checkpoint_t> symbols;
+} checkpoint_t;
+
+typedef struct {
+    size_t symbols;     // Restored, the rest is no longer in the universe
+    size_t indicators;  // Restored series
+    size_t measurements;
+    long ageMs;  // Of the checkpoint when it was restored
+} checkpoint_stats_t;
+
+namespace Checkpoint {
+
+extern const uint32_t VERSION;
+extern const long DEFAULT_INTERVAL_MS;
+extern const std::string path;  // data/checkpoint.bin
+
+// Indicator state and recent measurements of the symbols. The indicators
+// are copied between two ticks, the measurements right after.
+void capture(const std::vector<int>& symbols, checkpoint_t& out);
+
+// Writes a temporary file, syncs it and renames it over filePath, so a crash
+// leaves either the old or the new checkpoint. False on I/O errors.
+bool write(const std::string& filePath, const checkpoint_t& checkpoint);
+
+// Oldest checkpoint read() accepts. Sliding windows read the point leaving
+// them back from their input series, which cleanup evicts by age, so a
+// checkpoint has to be younger than the history minus the longest of them.
+long maxAgeMs();
+
+// False if the file is missing, torn, from a different layout or bar
+// interval, or older than maxAgeMs()
+bool read(const std::string& filePath, checkpoint_t& out);
+
+// Puts the state back for the symbols of the universe, before the first tick
+// and before ingest starts. The measurements go through storage again, so
+// bars are rebuilt, without touching the tick logs.
+checkpoint_stats_t restore(const checkpoint_t& checkpoint);
+
+// Captures and writes a checkpoint every intervalMs on a background thread
+void start(long intervalMs = DEFAULT_INTERVAL_MS);
+// Stops the thread and writes a last checkpoint
+void stop();
+
+}  // namespace Checkpoint
@@ -1,602 +1,505 @@
 #include "data_collector.hpp"
 
 #include <pthread.h>
+#include <sched.h>
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
 
+#include "../bars/bars.hpp"
+#include "../indicators/indicator_engine.hpp"
+#include "../indicators/series.hpp"
 #include "../measurement/measurement.hpp"
+#include "../metrics/latency.hpp"
 #include "../scheduler/scheduler.hpp"
+#include "../universe/universe.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/file_writer.hpp"
+#include "../utils/worker_pool.hpp"
 
-const long DataCollector::MA_WINDOW = 15 * 60 * 60 * 1000;  // 15 hours
-const long DataCollector::SHORT_TERM_EMA_WINDOW =
-    12 * 60 * 60 * 1000;  // 12 hours
-const long DataCollector::LONG_TERM_EMA_WINDOW =
-    26 * 60 * 60 * 1000;                                       // 26 hours
-const long DataCollector::SIGNAL_WINDOW = 9 * 60 * 60 * 1000;  // 9 hours
 const long DataCollector::AVERAGE_HISTORY_MS =
     3 * 24 * 60 * 60 * 1000;                                     // 3 days
 const long DataCollector::HISTORY_MS = 3 * 24 * 60 * 60 * 1000;  // 3 days
-std::map<std::string, std::deque<dataPoint_t>> DataCollector::latestAverages;
-std::map<std::string, std::deque<dataPoint_t>>
-    DataCollector::latestExponentialAverages;
-std::map<std::string, std::deque<dataPoint_t>>
-    DataCollector::latestShortTermEMA;
-std::map<std::string, std::deque<dataPoint_t>> DataCollector::latestLongTermEMA;
-std::map<std::string, std::deque<dataPoint_t>> DataCollector::latestMACD;
-std::map<std::string, std::deque<dataPoint_t>> DataCollector::latestSignal;
-std::map<std::string, std::deque<dataPoint_t>> DataCollector::latestDistance;
-std::map<std::string, std::deque<dataPoint_t>>
-    DataCollector::latestClosingPrices;
-std::map<std::string, std::deque<dataPoint_t>>
-    DataCollector::latestClosingVolumes;
+const size_t DataCollector::HISTORY_POINTS =
+    DataCollector::HISTORY_MS / IndicatorEngine::DEFAULT_BAR_MS;
+const std::vector<indicator_t> DataCollector::DEFAULT_INDICATORS = {
+    INDICATOR_CLOSE,     INDICATOR_SMA,  INDICATOR_EMA_SHORT,
+    INDICATOR_EMA_LONG,  INDICATOR_MACD, INDICATOR_SIGNAL,
+    INDICATOR_DISTANCE};
 pthread_mutex_t DataCollector::dataCollectorMutex;
+bool DataCollector::verbose = false;
+
+// One series per symbol and indicator, allocated on the first point of a
+// computed indicator and freed once it is no longer computed
+static series_t symbolSeries[MAX_SYMBOLS][INDICATOR_COUNT];
+
+// Readers never take dataCollectorMutex. The worker appends into the spare
+// slot of each ring and makes the tick visible in publish(), with
+// publishedVersion odd while the bounds change, so a reader whose copy
+// overlapped a publish just copies again.
+static std::atomic<unsigned long> publishedVersion(0);
+
+// Taken shared by readers, exclusively only while rings are allocated or
+// freed
+static pthread_rwlock_t seriesMemoryLock = PTHREAD_RWLOCK_INITIALIZER;
+
+// Indicator state carried between ticks, guarded by dataCollectorMutex
+static indicator_state_t indicatorStates[MAX_SYMBOLS];
+
+// Subscriptions and the resulting plan, guarded by dataCollectorMutex
+static const indicator_t REQUIRED[] = {INDICATOR_SMA, INDICATOR_VOLUME_SMA};
+static bool subscribed[INDICATOR_COUNT];
+static std::atomic<bool> computed[INDICATOR_COUNT];
+static indicator_plan_t plan;
+
+// Plans from the subscriptions, freeing the series of every indicator that
+// is no longer computed. Caller holds dataCollectorMutex.
+static void replan(int symbolCount) {
+    bool requested[INDICATOR_COUNT];
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        requested[i] = subscribed[i];
+    }
+    for (indicator_t indicator : REQUIRED) {
+        requested[indicator] = true;
+    }
 
-void* DataCollector::workerThread(void* arg) {
-    scheduler_t* scheduler = (scheduler_t*)arg;
-    std::vector<std::string> symbols = scheduler->SYMBOLS;
+    indicator_plan_t next;
+    if (!IndicatorEngine::plan(requested, next)) {
+        return;  // Keep the previous plan
+    }
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        computed[i] = next.active[i];
+    }
 
-    while (scheduler->running) {
-        // Wait for work signal
-        pthread_mutex_lock(&scheduler->averageMutex);
-        while (!scheduler->averageWorkReady && scheduler->running) {
-            pthread_cond_wait(&scheduler->averageCondition,
-                              &scheduler->averageMutex);
+    pthread_rwlock_wrlock(&seriesMemoryLock);
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        if (next.active[i]) {
+            continue;
         }
-
-        if (!scheduler->running) {
-            pthread_mutex_unlock(&scheduler->averageMutex);
-            break;
+        for (int symbol = 0; symbol < symbolCount; symbol++) {
+            Series::release(symbolSeries[symbol][i]);
         }
-
-        scheduler->averageWorkReady = false;
-        long timestamp = scheduler->currentTimestamp;
-        pthread_mutex_unlock(&scheduler->averageMutex);
-
-        calculateClosingPrice(symbols, timestamp);
-        calculateClosingVolume(symbols, timestamp);
-        calculateAverage(symbols, timestamp);
-        calculateAllExponentialAverages(symbols, timestamp);
-        calculateMACD(symbols, timestamp);
-        calculateSignal(symbols, timestamp, SIGNAL_WINDOW);
-        calculateDistance(symbols, timestamp);
     }
+    pthread_rwlock_unlock(&seriesMemoryLock);
 
-    return nullptr;
-}
-
-double getLatestValidValue(const std::deque<dataPoint_t>& deque) {
-    return deque.empty() ? 0.0 : deque.back().data;
+    plan = next;
 }
 
-void* DataCollector::calculateAverage(std::vector<std::string> symbols,
-                                      long currentTimestamp) {
-    for (const std::string& symbol : symbols) {
-        value_t recentClosingPrices = DataCollector::getRecentClosingPrices(
-            symbol, currentTimestamp, MA_WINDOW / (60 * 1000));
-
-        value_t recentClosingVolumes =
-            DataCollector::getRecentClosingVolumes(symbol, currentTimestamp,
-                                                   MA_WINDOW / (60 * 1000));
-
-        // Price
-        double sum = 0;
-        int count = recentClosingPrices.values.size();
-
-        for (double price : recentClosingPrices.values) {
-            sum += price;
-        }
-
-        double average = 0;
-        if (count > 0) {
-            average = sum / count;
-        } else {
-            average = getLatestValidValue(latestAverages[symbol]);
+// Before main, no symbol has series yet
+static struct DefaultSubscriptions {
+    DefaultSubscriptions() {
+        for (indicator_t indicator : DataCollector::DEFAULT_INDICATORS) {
+            subscribed[indicator] = true;
         }
+        replan(0);
+    }
+} defaultSubscriptions;
+
+// Allocates the series of every computed indicator the symbol does not have
+// yet, starting their state from scratch. Caller holds dataCollectorMutex,
+// pool tasks through runTick; the allocation itself excludes readers and
+// other tasks.
+static void allocateSymbol(int symbol) {
+    series_t* series = symbolSeries[symbol];
+    bool missing = false;
+    for (size_t i = 0; i < plan.length; i++) {
+        missing |= Series::capacity(series[plan.order[i]]) == 0;
+    }
+    if (!missing) {
+        return;
+    }
 
-        auto now = std::chrono::system_clock::now();
-        auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                             now.time_since_epoch())
-                             .count();
-        int delay = timestamp - currentTimestamp;
-
-        // Volume
-        double volumeSum = 0;
-        int volumeCount = recentClosingVolumes.values.size();
-        
-        for (double volume : recentClosingVolumes.values) {
-            volumeSum += volume;
-        }
-        
-        double volumeAverage = 0;
-        if (volumeCount > 0) {
-            volumeAverage = volumeSum / volumeCount;
-        } else {
-            volumeAverage = getLatestValidValue(latestClosingVolumes[symbol]);
+    pthread_rwlock_wrlock(&seriesMemoryLock);
+    for (size_t i = 0; i < plan.length; i++) {
+        indicator_t indicator = plan.order[i];
+        if (Series::capacity(series[indicator]) == 0) {
+            Series::init(series[indicator],
+                         DataCollector::seriesCapacity(indicator));
+            IndicatorEngine::reset(indicatorStates[symbol].slots[indicator],
+                                   indicator);
         }
-
-        DataCollector::storeAverage(symbol, average, volumeAverage, currentTimestamp, delay);
-
-        std::cout << "Moving average for " << symbol << ": " << average
-                  << std::endl;
     }
-
-    return nullptr;
+    pthread_rwlock_unlock(&seriesMemoryLock);
 }
 
-void* DataCollector::calculateAllExponentialAverages(
-    std::vector<std::string> symbols, long currentTimestamp) {
-    for (const std::string& symbol : symbols) {
-        std::vector<measurement_t> measurementsForSymbolShortTerm =
-            Measurement::getRecentMeasurements(symbol, SHORT_TERM_EMA_WINDOW,
-                                               currentTimestamp);
-        std::vector<measurement_t> measurementsForSymbolLongTerm =
-            Measurement::getRecentMeasurements(symbol, LONG_TERM_EMA_WINDOW,
-                                               currentTimestamp);
-
-        pthread_mutex_lock(&dataCollectorMutex);
-        double previousEMAShortTerm = 0;
-        double previousEMALongTerm = 0;
-        if (!latestShortTermEMA[symbol].empty()) {
-            previousEMAShortTerm = latestShortTermEMA[symbol].back().data;
-        }
-        if (!latestLongTermEMA[symbol].empty()) {
-            previousEMALongTerm = latestLongTermEMA[symbol].back().data;
-        }
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        double exponentialAverageShortTerm = calculateExponentialAverage(
-            measurementsForSymbolShortTerm, previousEMAShortTerm,
-            SHORT_TERM_EMA_WINDOW);
-        double exponentialAverageLongTerm = calculateExponentialAverage(
-            measurementsForSymbolLongTerm, previousEMALongTerm,
-            LONG_TERM_EMA_WINDOW);
+bool DataCollector::setBarInterval(long ms) {
+    const long MINUTE_MS = 60 * 1000;
+    const long HOUR_MS = 60 * MINUTE_MS;
 
-        dataPoint_t shortTermAverage = {
-            .data = exponentialAverageShortTerm,
-            .timestamp = currentTimestamp,
-        };
-
-        dataPoint_t longTermAverage = {
-            .data = exponentialAverageLongTerm,
-            .timestamp = currentTimestamp,
-        };
-
-        pthread_mutex_lock(&dataCollectorMutex);
-        latestLongTermEMA[symbol].push_back(longTermAverage);
-        latestShortTermEMA[symbol].push_back(shortTermAverage);
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        // std::cout << "Exponential moving average (short term) for " << symbol
-        //           << ": " << exponentialAverageShortTerm << std::endl;
-        // std::cout << "Exponential moving average (long term) for " << symbol
-        //           << ": " << exponentialAverageLongTerm << std::endl;
+    // Every minute boundary has to be a tick for cleanup and Pearson
+    bool seconds = ms >= 1000 && ms % 1000 == 0 && MINUTE_MS % ms == 0;
+    bool minutes = ms % MINUTE_MS == 0 && HOUR_MS % ms == 0;
+    if (ms <= 0 || !(seconds || minutes) || !Bars::canSpan(ms)) {
+        return false;
     }
 
-    return nullptr;
+    IndicatorEngine::setBarMs(ms);
+    return true;
 }
 
-double DataCollector::calculateExponentialAverage(
-    std::vector<measurement_t> measurements, const double previousEMA,
-    long window) {
-    const int n = window / (6 * 10000);
-    const double alpha = 2.0 / (n + 1);
-
-    if (measurements.empty()) {
-        return previousEMA;  // Return previous EMA instead of 0 when no data
+size_t DataCollector::seriesCapacity(indicator_t indicator) {
+    size_t capacity = HISTORY_MS / IndicatorEngine::barMs();
+    if (capacity > HISTORY_POINTS) {
+        capacity = HISTORY_POINTS;
     }
 
-    double currentPrice = measurements.back().px;
+    size_t lookback = IndicatorEngine::lookbackBars(indicator);
+    return lookback > capacity ? lookback : capacity;
+}
 
-    double exponentialAverage;
-    if (previousEMA == 0) {
-        exponentialAverage = currentPrice;
-    } else {
-        exponentialAverage = (currentPrice - previousEMA) * alpha + previousEMA;
+size_t DataCollector::bytesPerSymbol() {
+    size_t points = 0;
+    pthread_mutex_lock(&dataCollectorMutex);
+    for (size_t i = 0; i < plan.length; i++) {
+        points += seriesCapacity(plan.order[i]);
     }
-
-    return exponentialAverage;
+    pthread_mutex_unlock(&dataCollectorMutex);
+    return points * (sizeof(double) + sizeof(long));
 }
 
-void* DataCollector::calculateMACD(std::vector<std::string> symbols,
-                                   long currentTimestamp) {
-    for (const std::string& symbol : symbols) {
-        pthread_mutex_lock(&dataCollectorMutex);
-
-        double shortTermEMA = getLatestValidValue(latestShortTermEMA[symbol]);
-        double longTermEMA = getLatestValidValue(latestLongTermEMA[symbol]);
-        double previousMACD = getLatestValidValue(latestMACD[symbol]);
-
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        double macdValue;
-        if (shortTermEMA != 0 && longTermEMA != 0) {
-            macdValue = shortTermEMA - longTermEMA;
-        } else {
-            // Use previous MACD value if available, otherwise 0
-            macdValue = previousMACD;
-        }
-
-        dataPoint_t macd = {.data = macdValue, .timestamp = currentTimestamp};
-
-        pthread_mutex_lock(&dataCollectorMutex);
-        latestMACD[symbol].push_back(macd);
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        // std::cout << "MACD for " << symbol << ": " << macdValue
-        //           << std::endl;
+void DataCollector::setIndicators(const std::vector<indicator_t>& indicators) {
+    pthread_mutex_lock(&dataCollectorMutex);
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        subscribed[i] = false;
     }
-
-    return nullptr;
+    for (indicator_t indicator : indicators) {
+        subscribed[indicator] = true;
+    }
+    replan(SymbolRegistry::count());
+    pthread_mutex_unlock(&dataCollectorMutex);
 }
 
-void* DataCollector::calculateSignal(std::vector<std::string> symbols,
-                                     long currentTimestamp, long window) {
-    const int n = window / (6 * 10000);
-    const double alpha = 2.0 / (n + 1);
-
-    for (const std::string& symbol : symbols) {
-        pthread_mutex_lock(&dataCollectorMutex);
-
-        double currentMACD = getLatestValidValue(latestMACD[symbol]);
-        double previousSignal = getLatestValidValue(latestSignal[symbol]);
-
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        double signalValue;
-        if (currentMACD != 0) {
-            if (previousSignal == 0) {
-                signalValue = currentMACD;
-            } else {
-                signalValue =
-                    (currentMACD - previousSignal) * alpha + previousSignal;
-            }
-        } else {
-            // Use previous signal value if available, otherwise 0
-            signalValue = previousSignal;
-        }
-
-        dataPoint_t signal = {.data = signalValue,
-                              .timestamp = currentTimestamp};
-
-        pthread_mutex_lock(&dataCollectorMutex);
-        latestSignal[symbol].push_back(signal);
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        // std::cout << "Signal for " << symbol << ": " << signalValue
-        //           << std::endl;
+static bool setSubscribed(indicator_t indicator, bool value) {
+    pthread_mutex_lock(&DataCollector::dataCollectorMutex);
+    bool changed = subscribed[indicator] != value;
+    if (changed) {
+        subscribed[indicator] = value;
+        replan(SymbolRegistry::count());
     }
-
-    return nullptr;
+    pthread_mutex_unlock(&DataCollector::dataCollectorMutex);
+    return changed;
 }
 
-void* DataCollector::calculateDistance(std::vector<std::string> symbols,
-                                       long currentTimestamp) {
-    for (const std::string& symbol : symbols) {
-        pthread_mutex_lock(&dataCollectorMutex);
-
-        double currentMACD = getLatestValidValue(latestMACD[symbol]);
-        double currentSignal = getLatestValidValue(latestSignal[symbol]);
-        double previousDistance = getLatestValidValue(latestDistance[symbol]);
-
-        pthread_mutex_unlock(&dataCollectorMutex);
-
-        double distanceValue;
-        if (currentMACD != 0 && currentSignal != 0) {
-            distanceValue = currentMACD - currentSignal;
-        } else {
-            // Use previous distance value if available, otherwise 0
-            distanceValue = previousDistance;
-        }
-
-        dataPoint_t distance = {.data = distanceValue,
-                                .timestamp = currentTimestamp};
+bool DataCollector::subscribe(indicator_t indicator) {
+    return setSubscribed(indicator, true);
+}
 
-        pthread_mutex_lock(&dataCollectorMutex);
-        latestDistance[symbol].push_back(distance);
-        pthread_mutex_unlock(&dataCollectorMutex);
+bool DataCollector::unsubscribe(indicator_t indicator) {
+    return setSubscribed(indicator, false);
+}
 
-        // std::cout << "Distance for " << symbol << ": " << distanceValue
-        //           << std::endl;
-    }
+bool DataCollector::isSubscribed(indicator_t indicator) {
+    pthread_mutex_lock(&dataCollectorMutex);
+    bool result = subscribed[indicator];
+    pthread_mutex_unlock(&dataCollectorMutex);
+    return result;
+}
 
-    return nullptr;
+bool DataCollector::isComputed(indicator_t indicator) {
+    return computed[indicator];
 }
 
-void* DataCollector::calculateClosingPrice(std::vector<std::string> symbols,
-                                           long currentTimestamp) {
-    for (const std::string& symbol : symbols) {
-        std::vector<measurement_t> measurementsForSymbol =
-            Measurement::getRecentMeasurements(symbol, 60 * 1000,
-                                               currentTimestamp);
-
-        double closingPrice;
-        if (!measurementsForSymbol.empty()) {
-            // Get the most recent measurement as the closing price
-            measurement_t latestMeasurement = measurementsForSymbol.back();
-            closingPrice = latestMeasurement.px;
-        } else {
-            // Use previous closing price if available, otherwise 0
-            pthread_mutex_lock(&dataCollectorMutex);
-            closingPrice = getLatestValidValue(latestClosingPrices[symbol]);
-            pthread_mutex_unlock(&dataCollectorMutex);
+void* DataCollector::workerThread(void* arg) {
+    scheduler_t* scheduler = (scheduler_t*)arg;
+
+    while (scheduler->running) {
+        // Wait for work signal
+        pthread_mutex_lock(&scheduler->averageMutex);
+        while (!scheduler->averageWorkReady && scheduler->running) {
+            pthread_cond_wait(&scheduler->averageCondition,
+                              &scheduler->averageMutex);
         }
 
-        dataPoint_t closingPricePoint = {.data = closingPrice,
-                                         .timestamp = currentTimestamp};
+        if (!scheduler->running) {
+            pthread_mutex_unlock(&scheduler->averageMutex);
+            break;
+        }
 
-        pthread_mutex_lock(&dataCollectorMutex);
-        latestClosingPrices[symbol].push_back(closingPricePoint);
-        pthread_mutex_unlock(&dataCollectorMutex);
+        scheduler->averageWorkReady = false;
+        long timestamp = scheduler->currentTimestamp;
+        pthread_mutex_unlock(&scheduler->averageMutex);
 
-        // std::cout << "Closing price for " << symbol << ": " << closingPrice
-        //           << std::endl;
+        runTick(Universe::activeSymbols(), timestamp);
     }
 
     return nullptr;
 }
 
-void* DataCollector::calculateClosingVolume(std::vector<std::string> symbols,
-                                           long currentTimestamp) {
-    for (const std::string& symbol : symbols) {
-        std::vector<measurement_t> measurementsForSymbol =
-            Measurement::getRecentMeasurements(symbol, 60 * 1000,
-                                               currentTimestamp);
-
-        double closingVolume;
-        if (!measurementsForSymbol.empty()) {
-            // Get the most recent measurement as the closing volume
-            measurement_t latestMeasurement = measurementsForSymbol.back();
-            closingVolume = latestMeasurement.sz;
-        } else {
-            // Use previous closing volume if available, otherwise 0
-            pthread_mutex_lock(&dataCollectorMutex);
-            closingVolume = getLatestValidValue(latestClosingVolumes[symbol]);
-            pthread_mutex_unlock(&dataCollectorMutex);
-        }
+typedef struct {
+    const std::vector<int>* symbols;
+    long timestamp;
+    std::vector<average_point_t> averages;  // Indexed like symbols
+    std::vector<char> computed;             // Still active when its turn came
+} tick_job_t;
+
+// Every computed indicator of one symbol for the bar in one engine step.
+// Runs on the worker pool: a task only touches the series and state of its
+// own symbol, and runTick holds dataCollectorMutex for all of them.
+static void runSymbol(size_t index, void* arg) {
+    tick_job_t* job = (tick_job_t*)arg;
+    int symbol = (*job->symbols)[index];
+    long timestamp = job->timestamp;
+
+    // Unsubscribed since the tick read the universe. Its series are freed
+    // under dataCollectorMutex after the flag drops, so they stay freed.
+    if (!Universe::isActive(symbol)) {
+        return;
+    }
+    job->computed[index] = true;
+
+    allocateSymbol(symbol);
+
+    indicator_input_t in = {};
+    bar_t bar;
+    in.hasBar = Bars::getSealedSpan(symbol, IndicatorEngine::barMs(),
+                                    timestamp, bar);
+    if (in.hasBar) {
+        in.barHigh = bar.high;
+        in.barLow = bar.low;
+        in.barClose = bar.close;
+        in.barVolume = bar.volume;
+        in.barNotional = bar.notional;
+    }
 
-        dataPoint_t closingVolumePoint = {.data = closingVolume,
-                                         .timestamp = currentTimestamp};
+    // The EMAs follow the newest trade, only looked up if someone reads them
+    measurement_t latest;
+    if (plan.active[INDICATOR_EMA_SHORT]) {
+        in.hasShortTerm = Measurement::getLatestMeasurement(
+            symbol, IndicatorEngine::windowMs(INDICATOR_EMA_SHORT), timestamp,
+            latest);
+        in.shortTermPx = in.hasShortTerm ? latest.px : 0;
+    }
+    if (plan.active[INDICATOR_EMA_LONG]) {
+        in.hasLongTerm = Measurement::getLatestMeasurement(
+            symbol, IndicatorEngine::windowMs(INDICATOR_EMA_LONG), timestamp,
+            latest);
+        in.longTermPx = in.hasLongTerm ? latest.px : 0;
+    }
 
-        pthread_mutex_lock(&dataCollectorMutex);
-        latestClosingVolumes[symbol].push_back(closingVolumePoint);
-        pthread_mutex_unlock(&dataCollectorMutex);
+    double out[INDICATOR_COUNT];
+    IndicatorEngine::step(plan, indicatorStates[symbol], in,
+                          symbolSeries[symbol], timestamp, out);
 
-        // std::cout << "Closing volume for " << symbol << ": " << closingVolume
-        //           << std::endl;
-    }
+    average_point_t& point = job->averages[index];
+    point.average = out[INDICATOR_SMA];
+    point.volumeAverage = out[INDICATOR_VOLUME_SMA];
+    point.delay = Clock::nowMs() - timestamp;
 
-    return nullptr;
+    // Latency up to the last indicator of the tick for this symbol
+    Latency::record(STAGE_TICK_TO_PUBLISH, symbol,
+                    (Clock::nowMs() - timestamp) * 1000);
 }
 
-void DataCollector::storeAverage(std::string symbol, double averagePrice, double averageVolume,
-                                 long timestamp, int delay) {
-    dataPoint_t avg = {.data = averagePrice, .timestamp = timestamp};
+void DataCollector::runTick(const std::vector<int>& symbols,
+                            long timestamp) {
+    tick_job_t job;
+    job.symbols = &symbols;
+    job.timestamp = timestamp;
+    job.averages.resize(symbols.size());
+    job.computed.assign(symbols.size(), false);
 
     pthread_mutex_lock(&dataCollectorMutex);
-    latestAverages[symbol].push_back(avg);
+    WorkerPool::run(symbols.size(), runSymbol, &job);
     pthread_mutex_unlock(&dataCollectorMutex);
 
-    std::string filename = "data/average.txt";
+    // Every symbol is done, readers see the whole tick at once
+    publish();
 
-    FILE* fp = fopen(filename.c_str(), "a");
-    if (fp == NULL) {
-        std::cout << "Error opening the file " << filename << std::endl;
-        return;
+    // Written in symbol order, whichever thread finished first
+    for (size_t i = 0; i < symbols.size(); i++) {
+        if (job.computed[i]) {
+            storeAverage(symbols[i], job.averages[i], timestamp);
+        }
     }
+}
 
-    fprintf(fp, "%s %.6f %.6f %ld %d\n", symbol.c_str(), averagePrice, averageVolume, timestamp, delay);
-    fclose(fp);
-};
+void DataCollector::publish() {
+    int count = SymbolRegistry::count();
 
-value_t DataCollector::getRecentEMA(const std::string& symbol, long timestamp,
-                                    size_t window, std::string type) {
     pthread_mutex_lock(&dataCollectorMutex);
+    unsigned long version = publishedVersion.load(std::memory_order_relaxed);
+    publishedVersion.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
 
-    value_t result;
-    const std::deque<dataPoint_t>* averages;
-    if (type == "short") {
-        averages = &latestShortTermEMA[symbol];
-    } else if (type == "long") {
-        averages = &latestLongTermEMA[symbol];
-    } else {
-        std::cerr << "Invalid type: " << type << std::endl;
-        pthread_mutex_unlock(&dataCollectorMutex);
-        return result;
+    for (int symbol = 0; symbol < count; symbol++) {
+        for (size_t i = 0; i < plan.length; i++) {
+            Series::publish(symbolSeries[symbol][plan.order[i]]);
+        }
     }
 
-    size_t startPos =
-        averages->size() > window && window > 0 ? averages->size() - window : 0;
-    for (size_t i = startPos; i < averages->size(); i++) {
-        result.values.push_back(averages->at(i).data);
-        result.timestamps.push_back(averages->at(i).timestamp);
-    }
+    publishedVersion.store(version + 2, std::memory_order_release);
     pthread_mutex_unlock(&dataCollectorMutex);
-
-    return result;
 }
 
-value_t DataCollector::getRecentAverages(const std::string& symbol,
-                                         long timestamp, size_t window) {
-    pthread_mutex_lock(&dataCollectorMutex);
+void DataCollector::storeAverage(int symbol, const average_point_t& point,
+                                 long timestamp) {
+    static const int averageFile = FileWriter::open("data/average.txt");
 
-    value_t result;
-    const std::deque<dataPoint_t>& averages = latestAverages[symbol];
+    FileWriter::format(averageFile, "%s %.6f %.6f %ld %d\n",
+                       SymbolRegistry::name(symbol).c_str(), point.average,
+                       point.volumeAverage, timestamp, point.delay);
 
-    size_t startPos =
-        averages.size() > window && window > 0 ? averages.size() - window : 0;
-    for (size_t i = startPos; i < averages.size(); i++) {
-        result.values.push_back(averages.at(i).data);
-        result.timestamps.push_back(averages.at(i).timestamp);
+    if (verbose) {
+        std::cout << "Moving average for " << SymbolRegistry::name(symbol)
+                  << ": " << point.average << std::endl;
     }
-    pthread_mutex_unlock(&dataCollectorMutex);
+};
 
-    return result;
-}
+// Copies the newest window published points (all for 0)
+static value_t copyRecent(const series_t& series, size_t window) {
+    series_slice_t slice = Series::slice(series, window);
 
-value_t DataCollector::getRecentMACD(const std::string& symbol, long timestamp,
-                                     size_t window) {
-    pthread_mutex_lock(&dataCollectorMutex);
     value_t result;
-    const std::deque<dataPoint_t>& macdData = latestMACD[symbol];
-
-    size_t startPos =
-        macdData.size() > window && window > 0 ? macdData.size() - window : 0;
-
-    for (size_t i = startPos; i < macdData.size(); i++) {
-        result.values.push_back(macdData.at(i).data);
-        result.timestamps.push_back(macdData.at(i).timestamp);
+    result.values.reserve(Series::length(slice));
+    result.timestamps.reserve(Series::length(slice));
+    for (int run = 0; run < 2; run++) {
+        result.values.insert(result.values.end(), slice.values[run],
+                             slice.values[run] + slice.length[run]);
+        result.timestamps.insert(result.timestamps.end(),
+                                 slice.timestamps[run],
+                                 slice.timestamps[run] + slice.length[run]);
     }
-    pthread_mutex_unlock(&dataCollectorMutex);
 
     return result;
 }
 
-value_t DataCollector::getRecentSignal(const std::string& symbol,
-                                       long timestamp, size_t window) {
-    pthread_mutex_lock(&dataCollectorMutex);
-
+value_t DataCollector::getRecent(indicator_t indicator, int symbol,
+                                 size_t window) {
     value_t result;
-    const std::deque<dataPoint_t>& signalData = latestSignal[symbol];
-
-    size_t startPos = signalData.size() > window && window > 0
-                          ? signalData.size() - window
-                          : 0;
-    for (size_t i = startPos; i < signalData.size(); i++) {
-        result.values.push_back(signalData.at(i).data);
-        result.timestamps.push_back(signalData.at(i).timestamp);
+    if (symbol < 0 || symbol >= MAX_SYMBOLS || indicator < 0 ||
+        indicator >= INDICATOR_COUNT) {
+        return result;
     }
-    pthread_mutex_unlock(&dataCollectorMutex);
-
-    return result;
-}
 
-value_t DataCollector::getRecentDistance(const std::string& symbol,
-                                         long timestamp, size_t window) {
-    pthread_mutex_lock(&dataCollectorMutex);
+    pthread_rwlock_rdlock(&seriesMemoryLock);
+    while (true) {
+        unsigned long before = publishedVersion.load(std::memory_order_acquire);
+        if (before & 1) {
+            sched_yield();  // A publish is only a few stores per series
+            continue;
+        }
 
-    value_t result;
-    const std::deque<dataPoint_t>& distanceData = latestDistance[symbol];
+        result = copyRecent(symbolSeries[symbol][indicator], window);
 
-    size_t startPos = distanceData.size() > window && window > 0
-                          ? distanceData.size() - window
-                          : 0;
-    for (size_t i = startPos; i < distanceData.size(); i++) {
-        result.values.push_back(distanceData.at(i).data);
-        result.timestamps.push_back(distanceData.at(i).timestamp);
+        // Valid unless the worker published, and so may have overwritten
+        // the oldest copied point, in the meantime
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (publishedVersion.load(std::memory_order_relaxed) == before) {
+            break;
+        }
     }
-    pthread_mutex_unlock(&dataCollectorMutex);
+    pthread_rwlock_unlock(&seriesMemoryLock);
 
     return result;
 }
 
-value_t DataCollector::getRecentClosingPrices(const std::string& symbol,
-                                              long timestamp, size_t window) {
-    pthread_mutex_lock(&dataCollectorMutex);
+void DataCollector::snapshot(
+    const std::vector<int>& symbols,
+    std::vector<std::vector<indicator_snapshot_t>>& out) {
+    out.assign(symbols.size(), std::vector<indicator_snapshot_t>());
 
-    value_t result;
-    const std::deque<dataPoint_t>& closingPriceData =
-        latestClosingPrices[symbol];
+    pthread_mutex_lock(&dataCollectorMutex);
+    for (size_t i = 0; i < symbols.size(); i++) {
+        const series_t* series = symbolSeries[symbols[i]];
+        for (size_t j = 0; j < plan.length; j++) {
+            indicator_t indicator = plan.order[j];
+            const series_t& s = series[indicator];
+            if (Series::capacity(s) == 0) {
+                continue;
+            }
 
-    size_t startPos = closingPriceData.size() > window && window > 0
-                          ? closingPriceData.size() - window
-                          : 0;
-    for (size_t i = startPos; i < closingPriceData.size(); i++) {
-        result.values.push_back(closingPriceData.at(i).data);
-        result.timestamps.push_back(closingPriceData.at(i).timestamp);
+            indicator_snapshot_t snapshot;
+            snapshot.indicator = indicator;
+            snapshot.slot = indicatorStates[symbols[i]].slots[indicator];
+            snapshot.points.values.resize(s.size);
+            snapshot.points.timestamps.resize(s.size);
+            for (size_t k = 0; k < s.size; k++) {
+                snapshot.points.values[k] = Series::at(s, k);
+                snapshot.points.timestamps[k] = Series::timestampAt(s, k);
+            }
+            out[i].push_back(snapshot);
+        }
     }
     pthread_mutex_unlock(&dataCollectorMutex);
-
-    return result;
 }
 
-value_t DataCollector::getRecentClosingVolumes(const std::string& symbol,
-                                              long timestamp, size_t window) {
+size_t DataCollector::restore(
+    int symbol, const std::vector<indicator_snapshot_t>& snapshot) {
+    const indicator_snapshot_t* saved[INDICATOR_COUNT] = {};
+    for (const indicator_snapshot_t& entry : snapshot) {
+        saved[entry.indicator] = &entry;
+    }
+
+    bool restored[INDICATOR_COUNT] = {};
+    size_t count = 0;
+
     pthread_mutex_lock(&dataCollectorMutex);
+    pthread_rwlock_wrlock(&seriesMemoryLock);
+    // Inputs come first in the plan, so their fate is known by then
+    for (size_t i = 0; i < plan.length; i++) {
+        indicator_t indicator = plan.order[i];
+        if (saved[indicator] == nullptr) {
+            continue;
+        }
+        // A window that changed since the checkpoint needs a fresh start
+        bool usable = saved[indicator]->slot.sums[0].window ==
+                      (size_t)IndicatorEngine::windowBars(indicator);
+        for (indicator_t input : IndicatorEngine::inputs(indicator)) {
+            usable &= restored[input];
+        }
+        if (!usable) {
+            continue;
+        }
 
-    value_t result;
-    const std::deque<dataPoint_t>& closingVolumeData =
-        latestClosingVolumes[symbol];
+        const value_t& points = saved[indicator]->points;
+        series_t& series = symbolSeries[symbol][indicator];
+        Series::init(series, seriesCapacity(indicator));
+        for (size_t k = 0; k < points.values.size(); k++) {
+            Series::append(series, points.timestamps[k], points.values[k]);
+        }
+        indicatorStates[symbol].slots[indicator] = saved[indicator]->slot;
 
-    size_t startPos = closingVolumeData.size() > window && window > 0
-                          ? closingVolumeData.size() - window
-                          : 0;
-    for (size_t i = startPos; i < closingVolumeData.size(); i++) {
-        result.values.push_back(closingVolumeData.at(i).data);
-        result.timestamps.push_back(closingVolumeData.at(i).timestamp);
+        restored[indicator] = true;
+        count++;
     }
+    pthread_rwlock_unlock(&seriesMemoryLock);
     pthread_mutex_unlock(&dataCollectorMutex);
 
-    return result;
+    return count;
 }
 
 void DataCollector::cleanupOldAverages(long currentTimestamp) {
-    for (auto& pair : latestAverages) {
-        std::deque<dataPoint_t>& symbolAverages = pair.second;
-        while (!symbolAverages.empty() &&
-               (currentTimestamp - symbolAverages.front().timestamp >
-                AVERAGE_HISTORY_MS)) {
-            symbolAverages.pop_front();
-        }
+    int count = SymbolRegistry::count();
+    pthread_mutex_lock(&dataCollectorMutex);
+    for (int symbol = 0; symbol < count; symbol++) {
+        Series::evictBefore(symbolSeries[symbol][INDICATOR_SMA],
+                            currentTimestamp - AVERAGE_HISTORY_MS);
     }
+    pthread_mutex_unlock(&dataCollectorMutex);
 }
 
 void DataCollector::cleanupOldData(long currentTimestamp) {
-    // short-term EMA data
-    for (auto& pair : latestShortTermEMA) {
-        std::deque<dataPoint_t>& shortTermEMA = pair.second;
-        while (
-            !shortTermEMA.empty() &&
-            (currentTimestamp - shortTermEMA.front().timestamp > HISTORY_MS)) {
-            shortTermEMA.pop_front();
-        }
-    }
-
-    // long-term EMA data
-    for (auto& pair : latestLongTermEMA) {
-        std::deque<dataPoint_t>& longTermEMA = pair.second;
-        while (
-            !longTermEMA.empty() &&
-            (currentTimestamp - longTermEMA.front().timestamp > HISTORY_MS)) {
-            longTermEMA.pop_front();
-        }
-    }
-
-    // MACD data
-    for (auto& pair : latestMACD) {
-        std::deque<dataPoint_t>& macdData = pair.second;
-        while (!macdData.empty() &&
-               (currentTimestamp - macdData.front().timestamp > HISTORY_MS)) {
-            macdData.pop_front();
-        }
-    }
-
-    // signal data
-    for (auto& pair : latestSignal) {
-        std::deque<dataPoint_t>& signalData = pair.second;
-        while (!signalData.empty() &&
-               (currentTimestamp - signalData.front().timestamp > HISTORY_MS)) {
-            signalData.pop_front();
-        }
-    }
-
-    // distance data
-    for (auto& pair : latestDistance) {
-        std::deque<dataPoint_t>& distanceData = pair.second;
-        while (
-            !distanceData.empty() &&
-            (currentTimestamp - distanceData.front().timestamp > HISTORY_MS)) {
-            distanceData.pop_front();
+    int count = SymbolRegistry::count();
+    pthread_mutex_lock(&dataCollectorMutex);
+    for (int symbol = 0; symbol < count; symbol++) {
+        for (int i = 0; i < INDICATOR_COUNT; i++) {
+            if (i == INDICATOR_SMA) {
+                continue;  // Kept for AVERAGE_HISTORY_MS instead
+            }
+            Series::evictBefore(symbolSeries[symbol][i],
+                                currentTimestamp - HISTORY_MS);
         }
     }
+    pthread_mutex_unlock(&dataCollectorMutex);
+}
 
-    // closing price data
-    for (auto& pair : latestClosingPrices) {
-        std::deque<dataPoint_t>& closingPriceData = pair.second;
-        while (!closingPriceData.empty() &&
-               (currentTimestamp - closingPriceData.front().timestamp >
-                HISTORY_MS)) {
-            closingPriceData.pop_front();
-        }
+void DataCollector::clearSymbol(int symbol) {
+    pthread_mutex_lock(&dataCollectorMutex);
+    pthread_rwlock_wrlock(&seriesMemoryLock);
+    for (series_t& series : symbolSeries[symbol]) {
+        Series::release(series);
     }
+    pthread_rwlock_unlock(&seriesMemoryLock);
+    pthread_mutex_unlock(&dataCollectorMutex);
 }
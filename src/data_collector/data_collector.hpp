@@ -2,79 +2,94 @@
 
 #include <pthread.h>
 
-#include <deque>
-#include <map>
 #include <string>
 #include <vector>
 
+#include "../indicators/indicator_engine.hpp"
 #include "../measurement/measurement.hpp"
+#include "../utils/symbol_registry.hpp"
 
 struct calculateAverageArgs {
-    std::vector<std::string> SYMBOLS;
+    std::vector<int> SYMBOLS;
     long timestampInMs;
 };
 
-typedef struct {
-    double data;
-    long timestamp;
-} dataPoint_t;
-
 typedef struct {
     std::vector<double> values;
     std::vector<long> timestamps;
 } value_t;
 
+// Moving averages of one symbol for the bar, written out after the tick
+typedef struct {
+    double average;
+    double volumeAverage;
+    int delay;  // ms from the bar boundary to the computation
+} average_point_t;
+
+// One computed indicator of one symbol as it stands between ticks, for
+// checkpoints
+typedef struct {
+    indicator_t indicator;
+    indicator_slot_t slot;
+    value_t points;  // Oldest first
+} indicator_snapshot_t;
+
 namespace DataCollector {
 
-extern const long MA_WINDOW;
-extern const long SIGNAL_WINDOW;
-extern const long SHORT_TERM_EMA_WINDOW;
-extern const long LONG_TERM_EMA_WINDOW;
 extern const long AVERAGE_HISTORY_MS;
 extern const long HISTORY_MS;
-extern std::map<std::string, std::deque<dataPoint_t>> latestAverages;
-extern std::map<std::string, std::deque<dataPoint_t>> latestExponentialAverages;
-extern std::map<std::string, std::deque<dataPoint_t>> latestShortTermEMA;
-extern std::map<std::string, std::deque<dataPoint_t>> latestLongTermEMA;
-extern std::map<std::string, std::deque<dataPoint_t>> latestMACD;
-extern std::map<std::string, std::deque<dataPoint_t>> latestSignal;
-extern std::map<std::string, std::deque<dataPoint_t>> latestDistance;
-extern std::map<std::string, std::deque<dataPoint_t>> latestClosingPrices;
-extern std::map<std::string, std::deque<dataPoint_t>> latestClosingVolumes;
+// Most points served per series, HISTORY_MS of one-minute bars. Shorter bars
+// keep a shorter history rather than more memory.
+extern const size_t HISTORY_POINTS;
+// Subscribed unless --indicators says otherwise: everything the original
+// endpoints serve
+extern const std::vector<indicator_t> DEFAULT_INDICATORS;
+// Serializes the writers (a whole runTick, cleanup, clearSymbol and
+// subscription changes). Readers go through getRecent and never take it.
 extern pthread_mutex_t dataCollectorMutex;
+// Also print every average on stdout, a flushed line per symbol and bar
+extern bool verbose;
+
+// One tick per bar, every ms, aligned to the epoch. Call before the first
+// tick. False unless ms is a number of seconds that divides a minute or of
+// minutes that divides an hour.
+bool setBarInterval(long ms);
+// Points of one indicator's ring: the served history, or more if a window
+// slides over the indicator
+size_t seriesCapacity(indicator_t indicator);
 
-void storeAverage(std::string symbol, double average, double volume, long timestamp,
-                  int delay);
+void storeAverage(int symbol, const average_point_t& point, long timestamp);
 void cleanupOldAverages(long currentTimestamp);
 void cleanupOldData(long currentTimestamp);
-void* calculateAverage(std::vector<std::string> symbols, long currentTimestamp);
-void* calculateAllExponentialAverages(std::vector<std::string> symbols,
-                                      long currentTimestamp);
-double calculateExponentialAverage(std::vector<measurement_t> measurements,
-                                   const double previousEMA, long window);
-void* calculateMACD(std::vector<std::string> symbols, long currentTimestamp);
-void* calculateSignal(std::vector<std::string> symbols, long currentTimestamp,
-                      long window);
-void* calculateDistance(std::vector<std::string> symbols,
-                        long currentTimestamp);
-void* calculateClosingPrice(std::vector<std::string> symbols,
-                            long currentTimestamp);
-void* calculateClosingVolume(std::vector<std::string> symbols,
-                              long currentTimestamp);
+void clearSymbol(int symbol);  // Frees all series of the symbol
+size_t bytesPerSymbol();       // Series memory of one active symbol
+
+// Only subscribed indicators and their inputs are computed and stored. sma
+// and volume_sma always are, average.txt and Pearson read them. Newly
+// computed indicators start from scratch, dropped ones free their series.
+void setIndicators(const std::vector<indicator_t>& indicators);
+bool subscribe(indicator_t indicator);    // False if already subscribed
+bool unsubscribe(indicator_t indicator);  // False if not subscribed
+bool isSubscribed(indicator_t indicator);
+bool isComputed(indicator_t indicator);   // Lock-free
+
 void* workerThread(void* arg);
-value_t getRecentAverages(const std::string& symbol, long timestamp,
-                          size_t window = 0);
-value_t getRecentEMA(const std::string& symbol, long timestamp, size_t window,
-                     std::string type);
-value_t getRecentMACD(const std::string& symbol, long timestamp,
-                      size_t window = 0);
-value_t getRecentSignal(const std::string& symbol, long timestamp,
-                        size_t window = 0);
-value_t getRecentDistance(const std::string& symbol, long timestamp,
-                          size_t window = 0);
-value_t getRecentClosingPrices(const std::string& symbol, long timestamp,
-                               size_t window = 0);
-value_t getRecentClosingVolumes(const std::string& symbol, long timestamp,
-                                 size_t window = 0);
+// Computes every symbol on the WorkerPool, then publishes once all are done
+void runTick(const std::vector<int>& symbols, long timestamp);
+// Makes the points computed so far visible to getRecent, once per tick
+void publish();
+// The newest window points of one indicator of the symbol, all for 0. Sees
+// the series as of the last publish(), empty if the indicator is not
+// computed.
+value_t getRecent(indicator_t indicator, int symbol, size_t window = 0);
+
+// Copies every computed indicator of the symbols, all as of the same tick
+void snapshot(const std::vector<int>& symbols,
+              std::vector<std::vector<indicator_snapshot_t>>& out);
+// Puts a snapshot back before the symbol's first tick. Indicators that are
+// not computed, whose window changed or whose inputs are missing from the
+// snapshot are skipped and start from scratch. Returns how many were
+// restored; publish() makes them visible.
+size_t restore(int symbol, const std::vector<indicator_snapshot_t>& snapshot);
 
 }  // namespace DataCollector
@@ -0,0 +1,408 @@
+#include "indicator_engine.hpp"
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+
+const long IndicatorEngine::DEFAULT_BAR_MS = 60 * 1000;
+const size_t IndicatorEngine::MAX_INPUTS = 2;
+
+static long barInterval = IndicatorEngine::DEFAULT_BAR_MS;
+
+static const long SMA_WINDOW = 15 * 60 * 60 * 1000;             // 15 hours
+static const long SHORT_TERM_EMA_WINDOW = 12 * 60 * 60 * 1000;  // 12 hours
+static const long LONG_TERM_EMA_WINDOW = 26 * 60 * 60 * 1000;   // 26 hours
+static const long SIGNAL_WINDOW = 9 * 60 * 60 * 1000;           // 9 hours
+static const long RSI_WINDOW = 14 * 60 * 1000;                  // 14 minutes
+static const long BOLLINGER_WINDOW = 20 * 60 * 1000;            // 20 minutes
+static const long ATR_WINDOW = 14 * 60 * 1000;                  // 14 minutes
+static const double BOLLINGER_WIDTH = 2.0;  // Standard deviations
+
+typedef struct {
+    const indicator_input_t& in;
+    const double* values;  // This bar's outputs, valid for the inputs
+    const series_t* series;
+} step_context_t;
+
+typedef double (*indicator_step_t)(indicator_slot_t& slot,
+                                   const step_context_t& ctx, long bars);
+
+typedef struct {
+    const char* name;
+    indicator_t inputs[2];  // MAX_INPUTS
+    size_t inputCount;
+    long windowMs;  // 0 if the indicator has no window
+    bool slides;    // Reads the input values leaving the window back
+    indicator_step_t step;
+} indicator_definition_t;
+
+// The value dropping out of a bars-long window over series, which already
+// holds this bar's point
+static double leaving(const series_t& series, long bars) {
+    size_t n = series.size;
+    return n > (size_t)bars ? Series::at(series, n - 1 - bars) : 0.0;
+}
+
+// Wilder smoothing: the plain mean of the first bars values, then
+// (previous * (bars - 1) + value) / bars. seen counts the earlier values.
+static void wilder(double& average, double value, long seen, long bars) {
+    if (seen < bars) {
+        average += value / bars;
+    } else {
+        average = (average * (bars - 1) + value) / bars;
+    }
+}
+
+// close: the last trade of the bar, carried over bars without trades
+static double stepClose(indicator_slot_t& slot, const step_context_t& ctx,
+                        long bars) {
+    return ctx.in.hasBar ? ctx.in.barClose : slot.value;
+}
+
+// volume, notional: what traded within the bar, a bar without trades had none
+static double stepVolume(indicator_slot_t& slot, const step_context_t& ctx,
+                         long bars) {
+    return ctx.in.hasBar ? ctx.in.barVolume : 0.0;
+}
+
+static double stepNotional(indicator_slot_t& slot, const step_context_t& ctx,
+                           long bars) {
+    return ctx.in.hasBar ? ctx.in.barNotional : 0.0;
+}
+
+// sma, volume_sma, bollinger_middle: sums[0] slides over the input
+static double stepMean(indicator_t input, indicator_slot_t& slot,
+                       const step_context_t& ctx, long bars) {
+    RunningSum::push(slot.sums[0], ctx.values[input],
+                     leaving(ctx.series[input], bars));
+    return RunningSum::mean(slot.sums[0]);
+}
+
+static double stepSMA(indicator_slot_t& slot, const step_context_t& ctx,
+                      long bars) {
+    return stepMean(INDICATOR_CLOSE, slot, ctx, bars);
+}
+
+static double stepVolumeSMA(indicator_slot_t& slot, const step_context_t& ctx,
+                            long bars) {
+    return stepMean(INDICATOR_VOLUME, slot, ctx, bars);
+}
+
+static double stepBollingerMiddle(indicator_slot_t& slot,
+                                  const step_context_t& ctx, long bars) {
+    return stepMean(INDICATOR_CLOSE, slot, ctx, bars);
+}
+
+// ema_short, ema_long: follow the newest trade within the window, holding
+// their value while the window has none
+static double stepShortTermEMA(indicator_slot_t& slot,
+                               const step_context_t& ctx, long bars) {
+    if (!ctx.in.hasShortTerm) {
+        return slot.value;
+    }
+    return IndicatorEngine::ema(slot.value, ctx.in.shortTermPx,
+                                2.0 / (bars + 1));
+}
+
+static double stepLongTermEMA(indicator_slot_t& slot,
+                              const step_context_t& ctx, long bars) {
+    if (!ctx.in.hasLongTerm) {
+        return slot.value;
+    }
+    return IndicatorEngine::ema(slot.value, ctx.in.longTermPx,
+                                2.0 / (bars + 1));
+}
+
+// macd, signal, distance keep their previous value until both of their
+// inputs exist
+static double stepMACD(indicator_slot_t& slot, const step_context_t& ctx,
+                       long bars) {
+    double shortTerm = ctx.values[INDICATOR_EMA_SHORT];
+    double longTerm = ctx.values[INDICATOR_EMA_LONG];
+    return shortTerm != 0 && longTerm != 0 ? shortTerm - longTerm
+                                           : slot.value;
+}
+
+static double stepSignal(indicator_slot_t& slot, const step_context_t& ctx,
+                         long bars) {
+    double macd = ctx.values[INDICATOR_MACD];
+    return macd != 0 ? IndicatorEngine::ema(slot.value, macd, 2.0 / (bars + 1))
+                     : slot.value;
+}
+
+static double stepDistance(indicator_slot_t& slot, const step_context_t& ctx,
+                           long bars) {
+    double macd = ctx.values[INDICATOR_MACD];
+    double signal = ctx.values[INDICATOR_SIGNAL];
+    return macd != 0 && signal != 0 ? macd - signal : slot.value;
+}
+
+// rsi: aux[0] previous close, aux[1]/aux[2] Wilder averages of gains and
+// losses. 0 until the first window of changes has been seen.
+static double stepRSI(indicator_slot_t& slot, const step_context_t& ctx,
+                      long bars) {
+    double close = ctx.values[INDICATOR_CLOSE];
+    if (close == 0) {
+        return slot.value;
+    }
+    if (slot.aux[0] == 0) {
+        slot.aux[0] = close;
+        return slot.value;
+    }
+
+    double change = close - slot.aux[0];
+    slot.aux[0] = close;
+    wilder(slot.aux[1], change > 0 ? change : 0, slot.count, bars);
+    wilder(slot.aux[2], change < 0 ? -change : 0, slot.count, bars);
+    if (slot.count < bars && ++slot.count < bars) {
+        return slot.value;
+    }
+
+    double gain = slot.aux[1];
+    double loss = slot.aux[2];
+    if (loss == 0) {
+        return gain == 0 ? 50.0 : 100.0;
+    }
+    return 100.0 - 100.0 / (1.0 + gain / loss);
+}
+
+// bollinger_stddev: sums[0] slides over the squared closes, the mean comes
+// from bollinger_middle
+static double stepBollingerStddev(indicator_slot_t& slot,
+                                  const step_context_t& ctx, long bars) {
+    double close = ctx.values[INDICATOR_CLOSE];
+    double old = leaving(ctx.series[INDICATOR_CLOSE], bars);
+    RunningSum::push(slot.sums[0], close * close, old * old);
+
+    double mean = ctx.values[INDICATOR_BOLLINGER_MIDDLE];
+    double variance = RunningSum::mean(slot.sums[0]) - mean * mean;
+    return variance > 0 ? sqrt(variance) : 0.0;
+}
+
+static double stepBollingerUpper(indicator_slot_t& slot,
+                                 const step_context_t& ctx, long bars) {
+    return ctx.values[INDICATOR_BOLLINGER_MIDDLE] +
+           BOLLINGER_WIDTH * ctx.values[INDICATOR_BOLLINGER_STDDEV];
+}
+
+static double stepBollingerLower(indicator_slot_t& slot,
+                                 const step_context_t& ctx, long bars) {
+    return ctx.values[INDICATOR_BOLLINGER_MIDDLE] -
+           BOLLINGER_WIDTH * ctx.values[INDICATOR_BOLLINGER_STDDEV];
+}
+
+// atr: aux[0] previous close, aux[1] Wilder average of the true range. A bar
+// without trades has none. 0 until the first window has been seen.
+static double stepATR(indicator_slot_t& slot, const step_context_t& ctx,
+                      long bars) {
+    double close = ctx.values[INDICATOR_CLOSE];
+    if (close == 0) {
+        return slot.value;
+    }
+
+    double range = 0;
+    if (ctx.in.hasBar) {
+        range = ctx.in.barHigh - ctx.in.barLow;
+        if (slot.aux[0] != 0) {
+            range = fmax(range, fabs(ctx.in.barHigh - slot.aux[0]));
+            range = fmax(range, fabs(ctx.in.barLow - slot.aux[0]));
+        }
+    }
+    slot.aux[0] = close;
+
+    wilder(slot.aux[1], range, slot.count, bars);
+    if (slot.count < bars && ++slot.count < bars) {
+        return slot.value;
+    }
+    return slot.aux[1];
+}
+
+// vwap: sums[0] and sums[1] slide over notional and volume, holding the
+// value while the window had no volume
+static double stepVWAP(indicator_slot_t& slot, const step_context_t& ctx,
+                       long bars) {
+    RunningSum::push(slot.sums[0], ctx.values[INDICATOR_NOTIONAL],
+                     leaving(ctx.series[INDICATOR_NOTIONAL], bars));
+    RunningSum::push(slot.sums[1], ctx.values[INDICATOR_VOLUME],
+                     leaving(ctx.series[INDICATOR_VOLUME], bars));
+    return slot.sums[1].sum > 0 ? slot.sums[0].sum / slot.sums[1].sum
+                                : slot.value;
+}
+
+// The registry, in indicator_t order
+static const indicator_definition_t DEFINITIONS[INDICATOR_COUNT] = {
+    {"close", {}, 0, 0, false, stepClose},
+    {"volume", {}, 0, 0, false, stepVolume},
+    {"notional", {}, 0, 0, false, stepNotional},
+    {"sma", {INDICATOR_CLOSE}, 1, SMA_WINDOW, true, stepSMA},
+    {"volume_sma", {INDICATOR_VOLUME}, 1, SMA_WINDOW, true, stepVolumeSMA},
+    {"ema_short", {}, 0, SHORT_TERM_EMA_WINDOW, false, stepShortTermEMA},
+    {"ema_long", {}, 0, LONG_TERM_EMA_WINDOW, false, stepLongTermEMA},
+    {"macd", {INDICATOR_EMA_SHORT, INDICATOR_EMA_LONG}, 2, 0, false,
+     stepMACD},
+    {"signal", {INDICATOR_MACD}, 1, SIGNAL_WINDOW, false, stepSignal},
+    {"distance", {INDICATOR_MACD, INDICATOR_SIGNAL}, 2, 0, false,
+     stepDistance},
+    {"rsi", {INDICATOR_CLOSE}, 1, RSI_WINDOW, false, stepRSI},
+    {"bollinger_middle", {INDICATOR_CLOSE}, 1, BOLLINGER_WINDOW, true,
+     stepBollingerMiddle},
+    {"bollinger_stddev", {INDICATOR_CLOSE, INDICATOR_BOLLINGER_MIDDLE}, 2,
+     BOLLINGER_WINDOW, true, stepBollingerStddev},
+    {"bollinger_upper",
+     {INDICATOR_BOLLINGER_MIDDLE, INDICATOR_BOLLINGER_STDDEV}, 2, 0, false,
+     stepBollingerUpper},
+    {"bollinger_lower",
+     {INDICATOR_BOLLINGER_MIDDLE, INDICATOR_BOLLINGER_STDDEV}, 2, 0, false,
+     stepBollingerLower},
+    {"atr", {INDICATOR_CLOSE}, 1, ATR_WINDOW, false, stepATR},
+    {"vwap", {INDICATOR_NOTIONAL, INDICATOR_VOLUME}, 2, SMA_WINDOW, true,
+     stepVWAP},
+};
+
+long IndicatorEngine::barMs() { return barInterval; }
+
+void IndicatorEngine::setBarMs(long ms) { barInterval = ms; }
+
+const char* IndicatorEngine::name(indicator_t indicator) {
+    return DEFINITIONS[indicator].name;
+}
+
+int IndicatorEngine::lookup(const std::string& name) {
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        if (name == DEFINITIONS[i].name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+std::vector<indicator_t> IndicatorEngine::inputs(indicator_t indicator) {
+    const indicator_definition_t& definition = DEFINITIONS[indicator];
+    return std::vector<indicator_t>(
+        definition.inputs, definition.inputs + definition.inputCount);
+}
+
+long IndicatorEngine::windowBars(indicator_t indicator) {
+    long window = DEFINITIONS[indicator].windowMs;
+    if (window == 0) {
+        return 0;
+    }
+    return window >= barInterval ? window / barInterval : 1;
+}
+
+size_t IndicatorEngine::lookbackBars(indicator_t indicator) {
+    size_t lookback = 0;
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        const indicator_definition_t& definition = DEFINITIONS[i];
+        if (!definition.slides) {
+            continue;
+        }
+        // The window plus the point leaving it
+        size_t bars = windowBars((indicator_t)i) + 1;
+        for (size_t j = 0; j < definition.inputCount; j++) {
+            if (definition.inputs[j] == indicator && bars > lookback) {
+                lookback = bars;
+            }
+        }
+    }
+    return lookback;
+}
+
+long IndicatorEngine::windowMs(indicator_t indicator) {
+    return DEFINITIONS[indicator].windowMs;
+}
+
+bool IndicatorEngine::parseList(const std::string& list,
+                                std::vector<indicator_t>& out) {
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (name.empty()) {
+            continue;
+        }
+        int indicator = lookup(name);
+        if (indicator < 0) {
+            std::cerr << "Unknown indicator: " << name << std::endl;
+            return false;
+        }
+        out.push_back((indicator_t)indicator);
+    }
+    return true;
+}
+
+typedef enum { UNVISITED, VISITING, DONE } visit_state_t;
+
+// Depth-first, so every input is placed before the indicators reading it
+static bool visit(indicator_t indicator, visit_state_t* visits,
+                  indicator_plan_t& out) {
+    if (visits[indicator] == DONE) {
+        return true;
+    }
+    if (visits[indicator] == VISITING) {
+        std::cerr << "Indicator cycle through "
+                  << DEFINITIONS[indicator].name << std::endl;
+        return false;
+    }
+
+    visits[indicator] = VISITING;
+    const indicator_definition_t& definition = DEFINITIONS[indicator];
+    for (size_t i = 0; i < definition.inputCount; i++) {
+        if (!visit(definition.inputs[i], visits, out)) {
+            return false;
+        }
+    }
+    visits[indicator] = DONE;
+
+    out.active[indicator] = true;
+    out.order[out.length++] = indicator;
+    return true;
+}
+
+bool IndicatorEngine::plan(const bool requested[INDICATOR_COUNT],
+                           indicator_plan_t& out) {
+    visit_state_t visits[INDICATOR_COUNT] = {};
+    out.length = 0;
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        out.active[i] = false;
+    }
+
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        if (requested[i] && !visit((indicator_t)i, visits, out)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void IndicatorEngine::reset(indicator_slot_t& slot, indicator_t indicator) {
+    long bars = windowBars(indicator);
+    slot.value = 0;
+    slot.aux[0] = slot.aux[1] = slot.aux[2] = 0;
+    slot.count = 0;
+    slot.sums[0] = RunningSum::create(bars);
+    slot.sums[1] = RunningSum::create(bars);
+}
+
+void IndicatorEngine::step(const indicator_plan_t& plan,
+                           indicator_state_t& state,
+                           const indicator_input_t& in, series_t* series,
+                           long timestamp, double out[INDICATOR_COUNT]) {
+    step_context_t ctx = {in, out, series};
+
+    for (size_t i = 0; i < plan.length; i++) {
+        indicator_t indicator = plan.order[i];
+        indicator_slot_t& slot = state.slots[indicator];
+
+        slot.value =
+            DEFINITIONS[indicator].step(slot, ctx, windowBars(indicator));
+        out[indicator] = slot.value;
+        Series::append(series[indicator], timestamp, slot.value);
+    }
+}
+
+double IndicatorEngine::ema(double previous, double price, double alpha) {
+    if (previous == 0) {
+        return price;
+    }
+    return (price - previous) * alpha + previous;
+}
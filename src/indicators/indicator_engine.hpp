@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "running_sum.hpp"
+#include "series.hpp"
+
+// Every indicator the engine knows. Adding one takes an entry here and a
+// row in the registry table of indicator_engine.cpp.
+typedef enum {
+    INDICATOR_CLOSE,
+    INDICATOR_VOLUME,
+    INDICATOR_NOTIONAL,
+    INDICATOR_SMA,
+    INDICATOR_VOLUME_SMA,
+    INDICATOR_EMA_SHORT,
+    INDICATOR_EMA_LONG,
+    INDICATOR_MACD,
+    INDICATOR_SIGNAL,
+    INDICATOR_DISTANCE,
+    INDICATOR_RSI,
+    INDICATOR_BOLLINGER_MIDDLE,
+    INDICATOR_BOLLINGER_STDDEV,
+    INDICATOR_BOLLINGER_UPPER,
+    INDICATOR_BOLLINGER_LOWER,
+    INDICATOR_ATR,
+    INDICATOR_VWAP,
+    INDICATOR_COUNT
+} indicator_t;
+
+// What a bar brings in, fetched once per symbol and tick
+typedef struct {
+    bool hasBar;  // The bar had trades
+    double barHigh;
+    double barLow;
+    double barClose;
+    double barVolume;
+    double barNotional;
+    bool hasShortTerm;  // A trade within the short EMA window
+    double shortTermPx;
+    bool hasLongTerm;   // A trade within the long EMA window
+    double longTermPx;
+} indicator_input_t;
+
+// State one indicator carries from bar to bar for one symbol, see the step
+// functions for what each field holds
+typedef struct {
+    double value;  // Last output
+    double aux[3];
+    long count;
+    running_sum_t sums[2];
+} indicator_slot_t;
+
+// All state of one symbol, contiguous so a tick walks it in one pass
+typedef struct {
+    indicator_slot_t slots[INDICATOR_COUNT];
+} indicator_state_t;
+
+// Which indicators are computed, in an order where inputs come first
+typedef struct {
+    bool active[INDICATOR_COUNT];
+    indicator_t order[INDICATOR_COUNT];
+    size_t length;
+} indicator_plan_t;
+
+namespace IndicatorEngine {
+
+extern const long DEFAULT_BAR_MS;  // One-minute bars
+extern const size_t MAX_INPUTS;
+
+// Every indicator steps once per bar and appends one point. Windows are fixed
+// in time, so a shorter bar means more bars per window. Set before the first
+// step, the state of every indicator is sized from it.
+long barMs();
+void setBarMs(long ms);
+
+const char* name(indicator_t indicator);
+int lookup(const std::string& name);  // -1 if unknown
+std::vector<indicator_t> inputs(indicator_t indicator);
+long windowMs(indicator_t indicator);  // 0 if the indicator has no window
+// windowMs in bars, at least 1, or 0 if the indicator has no window
+long windowBars(indicator_t indicator);
+
+// Points of the indicator's own series that stepping reads back, 0 if no
+// indicator slides a window over it
+size_t lookbackBars(indicator_t indicator);
+
+// Comma-separated indicator names, e.g. from --indicators
+bool parseList(const std::string& list, std::vector<indicator_t>& out);
+
+// The requested indicators plus everything they depend on, topologically
+// ordered. False if the registry has a cycle.
+bool plan(const bool requested[INDICATOR_COUNT], indicator_plan_t& out);
+
+// Forgets everything the indicator has seen for one symbol
+void reset(indicator_slot_t& slot, indicator_t indicator);
+
+// Advances every planned indicator by one bar and appends each output to
+// series[indicator], right after computing it so later indicators can read
+// their inputs' history. out receives this bar's values.
+void step(const indicator_plan_t& plan, indicator_state_t& state,
+          const indicator_input_t& in, series_t* series, long timestamp,
+          double out[INDICATOR_COUNT]);
+
+// previous == 0 means no EMA yet, it starts at the price
+double ema(double previous, double price, double alpha);
+
+}  // namespace IndicatorEngine
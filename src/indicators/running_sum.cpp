@@ -0,0 +1,28 @@
+#include "running_sum.hpp"
+
+running_sum_t RunningSum::create(size_t window) {
+    running_sum_t s = {window, 0, 0, 0};
+    return s;
+}
+
+void RunningSum::reset(running_sum_t& s) { s = create(s.window); }
+
+static void add(running_sum_t& s, double value) {
+    double y = value - s.compensation;
+    double t = s.sum + y;
+    s.compensation = (t - s.sum) - y;
+    s.sum = t;
+}
+
+void RunningSum::push(running_sum_t& s, double value, double leaving) {
+    add(s, value);
+    if (s.count < s.window) {
+        s.count++;
+    } else {
+        add(s, -leaving);
+    }
+}
+
+double RunningSum::mean(const running_sum_t& s) {
+    return s.count > 0 ? s.sum / s.count : 0.0;
+}
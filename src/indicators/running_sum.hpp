@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Sum of the last `window` values of a series, updated in O(1) per value
+// with Kahan compensation so it does not drift over days of updates. The
+// series itself is not stored here, so several windows can slide over the
+// same history.
+typedef struct {
+    size_t window;
+    size_t count;         // Values currently in the window, up to window
+    double sum;
+    double compensation;  // Low-order bits lost by the last additions
+} running_sum_t;
+
+namespace RunningSum {
+
+running_sum_t create(size_t window);
+void reset(running_sum_t& s);
+
+// Adds value. Once the window is full, leaving (the value that just dropped
+// out of the window) is subtracted.
+void push(running_sum_t& s, double value, double leaving);
+
+double mean(const running_sum_t& s);  // 0 while empty
+
+}  // namespace RunningSum
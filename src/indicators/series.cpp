@@ -0,0 +1,104 @@
+#include "series.hpp"
+
+void Series::init(series_t& s, size_t capacity) {
+    // Plus the spare slot the writer fills before publishing
+    s.values.assign(capacity + 1, 0.0);
+    s.timestamps.assign(capacity + 1, 0);
+    s.head = 0;
+    s.size = 0;
+    s.publishedHead = 0;
+    s.publishedSize = 0;
+}
+
+void Series::release(series_t& s) {
+    std::vector<double>().swap(s.values);
+    std::vector<long>().swap(s.timestamps);
+    s.head = 0;
+    s.size = 0;
+    s.publishedHead = 0;
+    s.publishedSize = 0;
+}
+
+size_t Series::capacity(const series_t& s) {
+    return s.values.empty() ? 0 : s.values.size() - 1;
+}
+
+// Slot of the index-th oldest point
+static size_t slot(const series_t& s, size_t index) {
+    size_t i = s.head + index;
+    return i < s.values.size() ? i : i - s.values.size();
+}
+
+void Series::append(series_t& s, long timestamp, double value) {
+    if (s.values.empty()) {
+        return;
+    }
+
+    // Always the slot after the newest point, never a published one
+    size_t tail = slot(s, s.size);
+    s.values[tail] = value;
+    s.timestamps[tail] = timestamp;
+
+    if (s.size < capacity(s)) {
+        s.size++;
+    } else {
+        s.head = slot(s, 1);  // Full, the oldest point makes room
+    }
+}
+
+void Series::evictBefore(series_t& s, long timestamp) {
+    while (s.size > 0 && s.timestamps[s.head] < timestamp) {
+        s.head = slot(s, 1);
+        s.size--;
+    }
+}
+
+double Series::at(const series_t& s, size_t index) {
+    return s.values[slot(s, index)];
+}
+
+long Series::timestampAt(const series_t& s, size_t index) {
+    return s.timestamps[slot(s, index)];
+}
+
+double Series::last(const series_t& s) {
+    return s.size > 0 ? s.values[slot(s, s.size - 1)] : 0.0;
+}
+
+void Series::publish(series_t& s) {
+    s.publishedHead = s.head;
+    s.publishedSize = s.size;
+}
+
+series_slice_t Series::slice(const series_t& s, size_t count) {
+    series_slice_t result = {{nullptr, nullptr}, {nullptr, nullptr}, {0, 0}};
+    if (count == 0 || count > s.publishedSize) {
+        count = s.publishedSize;
+    }
+    if (count == 0) {
+        return result;
+    }
+
+    size_t capacity = s.values.size();
+    size_t first = s.publishedHead + s.publishedSize - count;
+    if (first >= capacity) {
+        first -= capacity;
+    }
+    size_t run = capacity - first < count ? capacity - first : count;
+
+    result.values[0] = &s.values[first];
+    result.timestamps[0] = &s.timestamps[first];
+    result.length[0] = run;
+
+    if (run < count) {
+        result.values[1] = &s.values[0];
+        result.timestamps[1] = &s.timestamps[0];
+        result.length[1] = count - run;
+    }
+
+    return result;
+}
+
+size_t Series::length(const series_slice_t& slice) {
+    return slice.length[0] + slice.length[1];
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Fixed-capacity ring of timestamped values. Values and timestamps live in
+// two separate arrays that are allocated once by init(); appending to a full
+// series overwrites the oldest point.
+//
+// One writer appends and evicts, readers only see the points as of the last
+// publish(). The arrays have one spare slot beyond the capacity, so a single
+// append between publishes never touches a published point.
+typedef struct {
+    std::vector<double> values;
+    std::vector<long> timestamps;
+    size_t head;  // Slot of the oldest point
+    size_t size;
+
+    // Reader view, only changed by publish()
+    size_t publishedHead;
+    size_t publishedSize;
+} series_t;
+
+// A range of points as at most two contiguous runs (the ring may wrap),
+// oldest first. Only valid while the series is not modified.
+typedef struct {
+    const double* values[2];
+    const long* timestamps[2];
+    size_t length[2];
+} series_slice_t;
+
+namespace Series {
+
+void init(series_t& s, size_t capacity);
+void release(series_t& s);  // Frees the arrays, capacity becomes 0
+
+size_t capacity(const series_t& s);
+void append(series_t& s, long timestamp, double value);
+void evictBefore(series_t& s, long timestamp);  // O(1) per evicted point
+
+// Writer side, index 0 is the oldest point
+double at(const series_t& s, size_t index);
+long timestampAt(const series_t& s, size_t index);
+double last(const series_t& s);  // 0 while empty
+
+// Makes everything appended or evicted so far visible to readers
+void publish(series_t& s);
+
+// Reader side: the newest count published points, all of them for count 0
+series_slice_t slice(const series_t& s, size_t count);
+size_t length(const series_slice_t& slice);
+
+}  // namespace Series
@@ -0,0 +1,95 @@
+#include "ingest.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+
+#include "../measurement/measurement.hpp"
+#include "../metrics/latency.hpp"
+
+const size_t Ingest::BATCH_SIZE = 256;
+
+static okx_client_t* active_client = nullptr;
+static std::atomic<bool> running(false);
+static pthread_t consumer;
+
+void Ingest::start(okx_client_t& client) {
+    if (!running) {
+        active_client = &client;
+        running = true;
+        pthread_create(&consumer, nullptr, consumerThread, &client);
+    }
+}
+
+void Ingest::stop() {
+    if (running) {
+        running = false;
+        pthread_join(consumer, nullptr);
+        active_client = nullptr;
+    }
+}
+
+// One pass over every connection's queue, returns the trades stored
+static size_t drainQueues(okx_client_t* client, std::vector<tick_t>& batch) {
+    size_t drained = 0;
+
+    for (okx_connection_t* connection : client->connections) {
+        size_t count = TickQueue::popBatch(connection->queue, batch.data(),
+                                           Ingest::BATCH_SIZE);
+        if (count == 0) {
+            continue;
+        }
+
+        Measurement::storeBatch(batch.data(), count);
+        drained += count;
+
+        long storedAt = Latency::nowNs();
+        for (size_t i = 0; i < count; i++) {
+            Latency::record(STAGE_PARSE_TO_STORE, batch[i].symbol,
+                            (storedAt - batch[i].parsedAt) / 1000);
+        }
+    }
+
+    return drained;
+}
+
+void* Ingest::consumerThread(void* arg) {
+    okx_client_t* client = (okx_client_t*)arg;
+    std::vector<tick_t> batch(BATCH_SIZE);
+    int idleRounds = 0;
+
+    while (running) {
+        // Spin briefly while trades keep coming, then back off
+        if (drainQueues(client, batch) > 0) {
+            idleRounds = 0;
+        } else if (++idleRounds > 64) {
+            usleep(500);
+        }
+    }
+
+    // The producers are stopped by now, store what they left in the queues
+    while (drainQueues(client, batch) > 0) {
+    }
+
+    return nullptr;
+}
+
+std::vector<ingest_stats_t> Ingest::getStats() {
+    std::vector<ingest_stats_t> stats;
+    if (active_client == nullptr) {
+        return stats;
+    }
+
+    for (const okx_connection_t* connection : active_client->connections) {
+        ingest_stats_t s;
+        s.connection = connection->id;
+        s.capacity = connection->queue.mask + 1;
+        s.depth = TickQueue::depth(connection->queue);
+        s.highWaterMark = connection->queue.highWaterMark;
+        s.drops = connection->queue.drops;
+        s.oversized = connection->oversized;
+        stats.push_back(s);
+    }
+
+    return stats;
+}
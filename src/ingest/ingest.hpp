@@ -0,0 +1,32 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "../websocket/okx_client.hpp"
+
+typedef struct {
+    int connection;
+    size_t capacity;
+    size_t depth;
+    size_t highWaterMark;
+    unsigned long drops;      // Trades the full queue turned away
+    unsigned long oversized;  // Messages too large for the receive buffer
+} ingest_stats_t;
+
+namespace Ingest {
+
+extern const size_t BATCH_SIZE;
+
+// Starts the consumer thread that drains every connection's tick queue into
+// Measurement storage
+void start(okx_client_t& client);
+// Stores what is left in the queues before returning, so stop the
+// connections first
+void stop();
+void* consumerThread(void* arg);
+std::vector<ingest_stats_t> getStats();
+
+}  // namespace Ingest
@@ -0,0 +1,61 @@
+#include "tick_queue.hpp"
+
+void TickQueue::init(tick_queue_t& queue, size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    queue.slots.assign(size, tick_t());
+    queue.mask = size - 1;
+    queue.tail = 0;
+    queue.head = 0;
+    queue.highWaterMark = 0;
+    queue.drops = 0;
+}
+
+bool TickQueue::push(tick_queue_t& queue, const tick_t& tick) {
+    size_t tail = queue.tail.load(std::memory_order_relaxed);
+    size_t head = queue.head.load(std::memory_order_acquire);
+
+    if (tail - head > queue.mask) {
+        queue.drops.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    queue.slots[tail & queue.mask] = tick;
+    queue.tail.store(tail + 1, std::memory_order_release);
+
+    // Only the producer writes the high-water mark
+    size_t depth = tail + 1 - head;
+    if (depth > queue.highWaterMark.load(std::memory_order_relaxed)) {
+        queue.highWaterMark.store(depth, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+size_t TickQueue::popBatch(tick_queue_t& queue, tick_t* out,
+                           size_t maxCount) {
+    size_t head = queue.head.load(std::memory_order_relaxed);
+    size_t tail = queue.tail.load(std::memory_order_acquire);
+
+    size_t count = tail - head;
+    if (count > maxCount) {
+        count = maxCount;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        out[i] = queue.slots[(head + i) & queue.mask];
+    }
+
+    queue.head.store(head + count, std::memory_order_release);
+    return count;
+}
+
+size_t TickQueue::depth(const tick_queue_t& queue) {
+    // Head first, so it can never be observed ahead of tail
+    size_t head = queue.head.load(std::memory_order_acquire);
+    size_t tail = queue.tail.load(std::memory_order_acquire);
+    return tail - head;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "../measurement/measurement.hpp"
+
+// Bounded lock-free single-producer/single-consumer ring of ticks. The
+// producer is a WebSocket service thread, the consumer is the ingest thread.
+typedef struct {
+    std::vector<tick_t> slots;
+    size_t mask;
+
+    // Producer and consumer indices live on separate cache lines
+    char pad0[64];
+    std::atomic<size_t> tail;  // Next slot to write (producer)
+    char pad1[64];
+    std::atomic<size_t> head;  // Next slot to read (consumer)
+    char pad2[64];
+
+    std::atomic<size_t> highWaterMark;
+    std::atomic<unsigned long> drops;
+} tick_queue_t;
+
+namespace TickQueue {
+
+// Capacity is rounded up to a power of two
+void init(tick_queue_t& queue, size_t capacity);
+
+// Never blocks. Returns false and counts a drop when the ring is full.
+bool push(tick_queue_t& queue, const tick_t& tick);
+
+// Moves up to maxCount ticks into out, returns how many were moved
+size_t popBatch(tick_queue_t& queue, tick_t* out, size_t maxCount);
+
+size_t depth(const tick_queue_t& queue);
+
+}  // namespace TickQueue
@@ -1,103 +1,317 @@
+#include <limits.h>
+#include <stdlib.h>
 #include <unistd.h>  // For usleep
 
+#include <chrono>
 #include <csignal>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
+#include "checkpoint/checkpoint.hpp"
+#include "data_collector/data_collector.hpp"
+#include "ingest/ingest.hpp"
+#include "measurement/measurement.hpp"
+#include "pearson/correlation_kernels.hpp"
+#include "pearson/pearson.hpp"
+#include "replay/replay.hpp"
 #include "scheduler/scheduler.hpp"
 #include "server/server.hpp"
+#include "universe/universe.hpp"
+#include "utils/file_writer.hpp"
 #include "utils/setup.hpp"
+#include "utils/worker_pool.hpp"
 #include "websocket/okx_client.hpp"
 
-const std::vector<std::string> SYMBOLS = {"BTC-USDT",  "ADA-USDT", "ETH-USDT",
-                                          "DOGE-USDT", "XRP-USDT", "SOL-USDT",
-                                          "LTC-USDT",  "BNB-USDT"};
+static volatile sig_atomic_t running = true;
 
-static bool running = true;
-static okx_client_t* client_ptr = nullptr;
+// Handle Ctrl+C signal, the main loop does the actual shutdown so queued
+// file writes get flushed
+void signalHandler(int signal) { running = false; }
 
-// Handle Ctrl+C signal
-void signalHandler(int signal) {
-    std::cout << "Received signal " << signal << ", shutting down..."
-              << std::endl;
-    running = false;
-    exit(0);
+// Follows admin subscribe/unsubscribe requests on the OKX connections
+static void onUniverseChange(const std::string& symbol, bool active,
+                             void* user) {
+    okx_client_t* client = (okx_client_t*)user;
+    if (active) {
+        OkxClient::subscribe(*client, symbol);
+    } else {
+        OkxClient::unsubscribe(*client, symbol);
+    }
+}
+
+// e.g. 250ms, 1s, 15s, 5m, 1h, in ms. 0 if malformed.
+static long parseDuration(const std::string& text) {
+    char* unit = nullptr;
+    long amount = strtol(text.c_str(), &unit, 10);
+    if (unit == text.c_str() || amount <= 0) {
+        return 0;
+    }
+    if (strcmp(unit, "ms") == 0) {
+        return amount;
+    }
+    if (strcmp(unit, "s") == 0) {
+        return amount * 1000;
+    }
+    if (strcmp(unit, "m") == 0) {
+        return amount * 60 * 1000;
+    }
+    if (strcmp(unit, "h") == 0) {
+        return amount * 60 * 60 * 1000;
+    }
+    return 0;
+}
+
+// Replays recorded tick logs instead of connecting to OKX
+static int runReplay(std::string directory,
+                     const std::vector<std::string>& symbols) {
+    if (directory.back() != '/') {
+        directory += '/';
+    }
+
+    // data/ is truncated on startup, so the input has to live elsewhere
+    char input[PATH_MAX];
+    char output[PATH_MAX];
+    if (realpath(directory.c_str(), input) == nullptr) {
+        std::cerr << "Replay directory not found: " << directory << std::endl;
+        return 1;
+    }
+    if (realpath(Setup::dataPath.c_str(), output) != nullptr &&
+        strcmp(input, output) == 0) {
+        std::cerr << "Copy the tick logs out of " << Setup::dataPath
+                  << " before replaying them" << std::endl;
+        return 1;
+    }
+
+    Setup::initializeFiles(symbols);
+    FileWriter::start();
+
+    replay_stats_t stats;
+    bool ok = Replay::run(directory, Universe::init(symbols), stats);
+
+    FileWriter::stop();
+
+    if (ok) {
+        std::cout << "Replayed " << stats.ticks << " ticks over "
+                  << stats.bars << " bars in " << stats.seconds
+                  << " s (" << stats.ticks / stats.seconds << " ticks/s)"
+                  << std::endl;
+    }
+    return ok ? 0 : 1;
 }
 
-int main() {
+int main(int argc, char** argv) {
     signal(SIGINT, signalHandler);
 
-    Setup::initializeFiles();
+    std::string replayDirectory;
+    std::vector<std::string> symbols;
+    int numConnections = 0;
+    int numThreads = 0;
+    long checkpointInterval = Checkpoint::DEFAULT_INTERVAL_MS;
+    long barGraceMs = Scheduler::DEFAULT_GRACE_MS;
+    bool fresh = false;
+    std::vector<indicator_t> indicators = DataCollector::DEFAULT_INDICATORS;
+    okx_endpoint_t endpoint = OkxClient::DEFAULT_ENDPOINT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--text-log") == 0) {
+            // Keep the human-readable tick files next to the binary logs
+            Measurement::textLogEnabled = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            // Print every symbol's moving average each bar
+            DataCollector::verbose = true;
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--symbols") == 0 && i + 1 < argc) {
+            // e.g. --symbols BTC-USDT,ETH-USDT
+            if (!Universe::parseList(argv[++i], symbols)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--symbols-file") == 0 && i + 1 < argc) {
+            if (!Universe::loadFile(argv[++i], symbols)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc) {
+            numConnections = atoi(argv[++i]);
+            if (numConnections < 1) {
+                std::cerr << "Invalid connection count: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--indicators") == 0 && i + 1 < argc) {
+            // e.g. --indicators close,sma,rsi,vwap, see GET /indicators
+            indicators.clear();
+            if (!IndicatorEngine::parseList(argv[++i], indicators)) {
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bar-interval") == 0 && i + 1 < argc) {
+            // e.g. --bar-interval 1s, one indicator point per bar
+            if (!DataCollector::setBarInterval(parseDuration(argv[++i]))) {
+                std::cerr << "Invalid bar interval: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--bar-grace") == 0 && i + 1 < argc) {
+            // e.g. --bar-grace 250ms, or 0 to tick right at the boundary
+            const char* value = argv[++i];
+            barGraceMs = strcmp(value, "0") == 0 ? 0 : parseDuration(value);
+            if (barGraceMs == 0 && strcmp(value, "0") != 0) {
+                std::cerr << "Invalid bar grace: " << value << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--checkpoint-interval") == 0 &&
+                   i + 1 < argc) {
+            // e.g. --checkpoint-interval 1m, or off
+            const char* value = argv[++i];
+            bool off = strcmp(value, "off") == 0;
+            checkpointInterval = off ? 0 : parseDuration(value);
+            if (checkpointInterval == 0 && !off) {
+                std::cerr << "Invalid checkpoint interval: " << value
+                          << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--fresh") == 0) {
+            // Ignore the checkpoint and empty data/ like a first start
+            fresh = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            // Indicator worker pool, one thread per core by default
+            numThreads = atoi(argv[++i]);
+            if (numThreads < 1) {
+                std::cerr << "Invalid thread count: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pearson-kernel") == 0 && i + 1 < argc) {
+            // e.g. --pearson-kernel scalar, the fastest one this CPU runs
+            // by default
+            if (!CorrelationKernels::select(argv[++i])) {
+                std::cerr << "Unsupported Pearson kernel: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pearson-window") == 0 && i + 1 < argc) {
+            // e.g. --pearson-window 4h, long windows go through the FFT
+            if (!Pearson::setWindow(parseDuration(argv[++i]))) {
+                std::cerr << "Invalid Pearson window: " << argv[i]
+                          << std::endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--endpoint") == 0 && i + 1 < argc) {
+            // e.g. ws://127.0.0.1:9000/ws/v5/public for tools/fake_okx
+            if (!OkxClient::parseEndpoint(argv[++i], endpoint)) {
+                std::cerr << "Invalid endpoint: " << argv[i] << std::endl;
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
 
-    // Create the WebSocket client
-    okx_client_t client = OkxClient::create(SYMBOLS);
-    client_ptr = &client;
+    // Checked once the bar interval is known, whatever the option order
+    if (!Scheduler::setGraceMs(barGraceMs)) {
+        std::cerr << "Bar grace must be shorter than a bar: " << barGraceMs
+                  << " ms" << std::endl;
+        return 1;
+    }
 
-    // Create the scheduler for periodic tasks
-    scheduler_t* scheduler = Scheduler::create(SYMBOLS);
+    if (symbols.empty()) {
+        symbols = Universe::DEFAULT_SYMBOLS;
+    }
 
-    // Connect to the WebSocket server
-    if (!OkxClient::connect(client)) {
-        std::cerr << "Failed to initial connection to WebSocket" << std::endl;
+    DataCollector::setIndicators(indicators);
+    WorkerPool::start(numThreads);
+    std::cout << "Pearson kernel: " << CorrelationKernels::active().name
+              << std::endl;
+
+    if (!replayDirectory.empty()) {
+        int status = runReplay(replayDirectory, symbols);
+        WorkerPool::stop();
+        return status;
     }
 
-    OkxClient::waitForSubscriptions(client);
+    // Warm restart: the files carry on and the state picks up where the
+    // checkpoint left it
+    checkpoint_t checkpoint;
+    bool warm = !fresh && Checkpoint::read(Checkpoint::path, checkpoint);
+
+    Setup::initializeFiles(symbols, warm);
+    FileWriter::start();
+    Universe::init(symbols);
+
+    if (warm) {
+        auto start = std::chrono::steady_clock::now();
+        checkpoint_stats_t restored = Checkpoint::restore(checkpoint);
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+        std::cout << "Restored " << restored.indicators << " series and "
+                  << restored.measurements << " trades of "
+                  << restored.symbols << " symbols from a checkpoint "
+                  << restored.ageMs / 1000 << " s old in " << ms << " ms"
+                  << std::endl;
+        checkpoint = checkpoint_t();
+    }
+
+    // Indicator storage is fixed per symbol and computed indicator, report
+    // what the universe costs
+    size_t seriesKb = DataCollector::bytesPerSymbol() / 1024;
+    std::cout << "Indicator series: " << seriesKb << " kB per symbol, "
+              << seriesKb * symbols.size() / 1024 << " MB for "
+              << symbols.size() << " symbols" << std::endl;
+
+    // By default one WebSocket connection per core, each with its own
+    // symbol shard
+    if (numConnections == 0) {
+        numConnections = sysconf(_SC_NPROCESSORS_ONLN);
+        if (numConnections > (int)symbols.size()) {
+            numConnections = symbols.size();
+        }
+    }
+    okx_client_t* client =
+        OkxClient::create(symbols, numConnections, endpoint);
+    Universe::setListener(onUniverseChange, client);
+
+    // Create the scheduler for periodic tasks
+    scheduler_t* scheduler = Scheduler::create();
+
+    // Drain parsed trades into storage off the network threads
+    Ingest::start(*client);
+
+    // Connect to the WebSocket server, each connection reconnects on its own
+    OkxClient::start(*client);
 
     HTTPServer server(80);
     server.start();
 
     Scheduler::start(*scheduler);
+    if (checkpointInterval > 0) {
+        Checkpoint::start(checkpointInterval);
+    }
     std::cout << "Crypto monitor is running. Press Ctrl+C to exit."
               << std::endl;
 
-    // Main event loop with reconnection logic
-    int reconnect_attempts = 0;
-    const int max_reconnects = 50;
-    const int reconnect_delay_ms = 5000;  // 5 seconds
-
     while (running) {
-        if (!OkxClient::isConnected(client)) {
-            if (reconnect_attempts < max_reconnects) {
-                std::cout << "Connection lost. Attempting to reconnect ("
-                          << reconnect_attempts + 1 << "/" << max_reconnects
-                          << ")..." << std::endl;
-
-                // Wait before reconnecting
-                usleep(reconnect_delay_ms * 1000);
-
-                if (OkxClient::connect(client)) {
-                    if (OkxClient::waitForSubscriptions(client)) {
-                        reconnect_attempts++;
-                        std::cerr << "Connection established but subscription "
-                                     "failed, retrying..."
-                                  << std::endl;
-                        OkxClient::destroy(client);
-                        continue;
-                    } else {
-                        std::cout << "Reconnection successful and subscription "
-                                     "confirmed"
-                                  << std::endl;
-                        reconnect_attempts = 0;
-                    }
-                } else {
-                    reconnect_attempts++;
-                    std::cerr << "Reconnection attempt failed" << std::endl;
-                    continue;
-                }
-            } else {
-                std::cerr << "Maximum reconnection attempts reached. Exiting."
-                          << std::endl;
-                break;
-            }
+        if (!OkxClient::isRunning(*client)) {
+            std::cerr << "Maximum reconnection attempts reached. Exiting."
+                      << std::endl;
+            break;
         }
 
-        if (OkxClient::isConnected(client)) {
-            lws_service(OkxClient::getContext(client), 100);
-        }
+        usleep(100 * 1000);  // 100ms
     }
 
+    std::cout << "Shutting down..." << std::endl;
+    Universe::setListener(nullptr, nullptr);
+    // HTTP handlers first, then the producers, so the consumer's last drain
+    // stores every trade before the final checkpoint. stop() frees nothing,
+    // the connections go in destroy() once nothing reads them.
+    server.stop();
+    OkxClient::stop(*client);
+    Ingest::stop();
     Scheduler::stop(*scheduler);
-    OkxClient::destroy(client);
+    Checkpoint::stop();
+    WorkerPool::stop();
+    FileWriter::stop();
+    OkxClient::destroy(*client);
+    delete client;
 
     std::cout << "Crypto monitor has shut down." << std::endl;
     return 0;
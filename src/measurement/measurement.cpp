@@ -1,17 +1,27 @@
 #include "measurement.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cstddef>
 #include <cstdio>
 #include <deque>
 #include <iostream>
-#include <map>
+
+#include "../bars/bars.hpp"
+#include "../tick_log/tick_log.hpp"
+#include "../universe/universe.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/file_writer.hpp"
 
 // Initialize in-memory storage
-std::map<std::string, std::deque<measurement_t>>
-    Measurement::latestMeasurements;
+std::deque<measurement_t> Measurement::latestMeasurements[MAX_SYMBOLS];
 pthread_mutex_t Measurement::measurementsMutex;
+static std::vector<int> measurementFiles(MAX_SYMBOLS, -1);
+static pthread_mutex_t measurementFilesMutex = PTHREAD_MUTEX_INITIALIZER;
 const long Measurement::MEASUREMENT_WINDOW_MS = 26 * 60 * 1000;  // 26 minutes
+const size_t Measurement::MAX_MEASUREMENTS_PER_SYMBOL = 32768;
+bool Measurement::tickLogEnabled = true;
+bool Measurement::textLogEnabled = false;
 
 measurement_t Measurement::create(double px, double sz, long ts) {
     measurement_t m;
@@ -26,53 +36,160 @@ void Measurement::displayMeasurement(const measurement_t& m) {
 };
 
 void Measurement::cleanupOldMeasurements(long currentTimestamp) {
-    for (auto& pair : latestMeasurements) {
-        std::deque<measurement_t>& symbolMeasurements = pair.second;
+    int count = SymbolRegistry::count();
+    pthread_mutex_lock(&measurementsMutex);
+    for (int symbol = 0; symbol < count; symbol++) {
+        std::deque<measurement_t>& symbolMeasurements =
+            latestMeasurements[symbol];
         while (!symbolMeasurements.empty() &&
                (currentTimestamp - symbolMeasurements.front().ts >
                 MEASUREMENT_WINDOW_MS)) {
             symbolMeasurements.pop_front();
         }
     }
+    pthread_mutex_unlock(&measurementsMutex);
+}
+
+void Measurement::clearSymbol(int symbol) {
+    pthread_mutex_lock(&measurementsMutex);
+    std::deque<measurement_t>().swap(latestMeasurements[symbol]);
+    pthread_mutex_unlock(&measurementsMutex);
+}
+
+typedef std::deque<measurement_t>::const_iterator measurement_iterator_t;
+
+static bool tsBefore(const measurement_t& m, long ts) { return m.ts < ts; }
+static bool tsAfter(long ts, const measurement_t& m) { return ts < m.ts; }
+
+// First measurement after timestamp, caller holds measurementsMutex
+static measurement_iterator_t rangeEnd(
+    const std::deque<measurement_t>& measurements, long timestamp) {
+    // Usually nothing arrived after timestamp yet, no search needed
+    if (measurements.empty() || measurements.back().ts <= timestamp) {
+        return measurements.end();
+    }
+    return std::upper_bound(measurements.begin(), measurements.end(),
+                            timestamp, tsAfter);
+}
+
+// Bounds of (timestamp - windowMs, timestamp], caller holds measurementsMutex
+static void findRange(const std::deque<measurement_t>& measurements,
+                      long windowMs, long timestamp,
+                      measurement_iterator_t& first,
+                      measurement_iterator_t& last) {
+    last = rangeEnd(measurements, timestamp);
+    first = std::lower_bound(measurements.begin(), last,
+                             timestamp - windowMs + 1, tsBefore);
 }
 
 std::vector<measurement_t> Measurement::getRecentMeasurements(
-    const std::string& symbol, const long windowMs, long timestamp) {
+    int symbol, const long windowMs, long timestamp) {
     std::vector<measurement_t> result;
 
     pthread_mutex_lock(&Measurement::measurementsMutex);
-    const std::deque<measurement_t>& measurements = latestMeasurements[symbol];
+    measurement_iterator_t first, last;
+    findRange(latestMeasurements[symbol], windowMs, timestamp, first, last);
+    result.assign(first, last);
     pthread_mutex_unlock(&Measurement::measurementsMutex);
 
-    result.assign(measurements.begin(), measurements.end());
-
     return result;
 }
 
-void Measurement::storeMeasurement(const std::string& symbol,
-                                   const measurement_t& m) {
+size_t Measurement::visitRecentMeasurements(int symbol, long windowMs,
+                                            long timestamp,
+                                            measurement_visitor_t visitor,
+                                            void* user) {
+    pthread_mutex_lock(&measurementsMutex);
+    measurement_iterator_t first, last;
+    findRange(latestMeasurements[symbol], windowMs, timestamp, first, last);
+    for (measurement_iterator_t it = first; it != last; ++it) {
+        visitor(*it, user);
+    }
+    size_t count = last - first;
+    pthread_mutex_unlock(&measurementsMutex);
+
+    return count;
+}
+
+bool Measurement::getLatestMeasurement(int symbol, long windowMs,
+                                       long timestamp, measurement_t& out) {
+    pthread_mutex_lock(&measurementsMutex);
+    const std::deque<measurement_t>& measurements = latestMeasurements[symbol];
+
+    measurement_iterator_t last = rangeEnd(measurements, timestamp);
+    bool found = last != measurements.begin() &&
+                 (last - 1)->ts > timestamp - windowMs;
+    if (found) {
+        out = *(last - 1);
+    }
+    pthread_mutex_unlock(&measurementsMutex);
+
+    return found;
+}
+
+// Keeps memory per symbol bounded even for bursts of trades within the window
+static void pushMeasurement(int symbol, const measurement_t& m) {
+    std::deque<measurement_t>& measurements =
+        Measurement::latestMeasurements[symbol];
+    if (measurements.size() >= Measurement::MAX_MEASUREMENTS_PER_SYMBOL) {
+        measurements.pop_front();
+    }
+    measurements.push_back(m);
+}
+
+void Measurement::storeMeasurement(int symbol, const measurement_t& m) {
     // Store in memory first
     pthread_mutex_lock(&measurementsMutex);
-    latestMeasurements[symbol].push_back(m);
+    pushMeasurement(symbol, m);
     pthread_mutex_unlock(&measurementsMutex);
 
-    // Write to symbol-specific file
-    std::string filename = "data/meas_" + symbol + ".txt";
+    Bars::update(symbol, m);
+    writeMeasurement(symbol, m);
+}
 
-    // open the file for writing
-    FILE* fp = fopen(filename.c_str(), "a");
-    if (fp == NULL) {
-        std::cout << "Error opening the file " << filename << std::endl;
-        return;
+void Measurement::storeBatch(const tick_t* ticks, size_t count) {
+    // One lock acquisition for the whole batch. Trades still queued for a
+    // symbol unsubscribed since are dropped, its history was cleared under
+    // this mutex after the flag dropped and has to stay empty.
+    pthread_mutex_lock(&measurementsMutex);
+    for (size_t i = 0; i < count; i++) {
+        if (Universe::isActive(ticks[i].symbol)) {
+            pushMeasurement(ticks[i].symbol, ticks[i].m);
+        }
     }
+    pthread_mutex_unlock(&measurementsMutex);
 
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         now.time_since_epoch())
-                         .count();
+    Bars::updateBatch(ticks, count);
+
+    for (size_t i = 0; i < count; i++) {
+        if (Universe::isActive(ticks[i].symbol)) {
+            writeMeasurement(ticks[i].symbol, ticks[i].m);
+        }
+    }
+}
+
+void Measurement::writeMeasurement(int symbol, const measurement_t& m) {
+    long timestamp = Clock::nowMs();
     auto delay = timestamp - m.ts;
 
-    // write to the text file
-    fprintf(fp, "%.6f %.6f %ld %ld\n", m.px, m.sz, m.ts, delay);
-    fclose(fp);
+    if (tickLogEnabled) {
+        TickLog::append(symbol, m, delay);
+    }
+
+    if (!textLogEnabled) {
+        return;
+    }
+
+    // Symbol-specific text file, opened once by the file writer
+    pthread_mutex_lock(&measurementFilesMutex);
+    if (measurementFiles[symbol] < 0) {
+        measurementFiles[symbol] = FileWriter::open(
+            "data/meas_" + SymbolRegistry::name(symbol) + ".txt");
+    }
+    int handle = measurementFiles[symbol];
+    pthread_mutex_unlock(&measurementFilesMutex);
+
+    // queue the line for the writer thread
+    FileWriter::format(handle, "%.6f %.6f %ld %ld\n", m.px, m.sz, m.ts,
+                       delay);
 }
@@ -1,29 +1,58 @@
 #pragma once
 
+#include <pthread.h>
+
 #include <deque>
-#include <map>
 #include <string>
 #include <vector>
 
+#include "../utils/symbol_registry.hpp"
+
 typedef struct {
     double px;  // Price
     double sz;  // Size/volume
     long ts;    // Timestamp
 } measurement_t;
 
+// Measurement tagged with the SymbolRegistry id of its symbol
+typedef struct {
+    measurement_t m;
+    int symbol;
+    long parsedAt;  // Latency::nowNs() when the trade was parsed
+} tick_t;
+
+// Called for every measurement of a range query, in time order. Runs with
+// measurementsMutex held and must not call back into Measurement.
+typedef void (*measurement_visitor_t)(const measurement_t& m, void* user);
+
 namespace Measurement {
 
-// In-memory storage for measurements (last 15 minutes)
-extern std::map<std::string, std::deque<measurement_t>> latestMeasurements;
+// In-memory storage for measurements (last 15 minutes), indexed by symbol id
+extern std::deque<measurement_t> latestMeasurements[MAX_SYMBOLS];
 extern pthread_mutex_t measurementsMutex;
 extern const long MEASUREMENT_WINDOW_MS;  // 15 minutes in milliseconds
+extern const size_t MAX_MEASUREMENTS_PER_SYMBOL;  // Oldest dropped beyond it
+extern bool tickLogEnabled;  // Write data/meas_<symbol>.bin (off in replay)
+extern bool textLogEnabled;  // Also write data/meas_<symbol>.txt (debugging)
 
 measurement_t create(double px, double sz, long ts);
 void displayMeasurement(const measurement_t& m);
-std::vector<measurement_t> getRecentMeasurements(const std::string& symbol,
+
+// Range queries cover (timestamp - windowMs, timestamp] and binary-search on
+// ts, which OKX sends in order per instrument. They read a consistent
+// snapshot under measurementsMutex.
+std::vector<measurement_t> getRecentMeasurements(int symbol,
                                                  const long windowMs,
                                                  long timestamp);
-void storeMeasurement(const std::string& symbol, const measurement_t& m);
+size_t visitRecentMeasurements(int symbol, long windowMs, long timestamp,
+                               measurement_visitor_t visitor, void* user);
+// Last trade in the range without copying the window, false if there is none
+bool getLatestMeasurement(int symbol, long windowMs, long timestamp,
+                          measurement_t& out);
+void storeMeasurement(int symbol, const measurement_t& m);
+void storeBatch(const tick_t* ticks, size_t count);  // Active symbols only
+void writeMeasurement(int symbol, const measurement_t& m);
 void cleanupOldMeasurements(long currentTimestamp);
+void clearSymbol(int symbol);  // Frees the symbol's history
 
 }  // namespace Measurement
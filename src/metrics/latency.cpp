@@ -0,0 +1,147 @@
+#include "latency.hpp"
+
+#include <chrono>
+#include <vector>
+
+#include "../utils/symbol_registry.hpp"
+
+static const int SUB_BUCKETS = 1 << LATENCY_SUB_BITS;
+static const int64_t MAX_VALUE =
+    ((int64_t)(2 * SUB_BUCKETS) << LATENCY_MAX_SHIFT) - 1;
+
+static const char* STAGE_NAMES[STAGE_COUNT] = {
+    "exchange_to_receive", "receive_to_parse", "parse_to_store",
+    "tick_to_publish", "http_request"};
+
+// Indexed [symbol + 1][stage], row 0 aggregates all symbols
+static std::atomic<latency_histogram_t*>
+    histograms[(MAX_SYMBOLS + 1) * STAGE_COUNT];
+
+static int bucketIndex(int64_t value) {
+    if (value < 0) {
+        value = 0;
+    }
+    if (value > MAX_VALUE) {
+        value = MAX_VALUE;
+    }
+    if (value < 2 * SUB_BUCKETS) {
+        return value;
+    }
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - LATENCY_SUB_BITS;
+    int top = value >> shift;
+    return (shift + 1) * SUB_BUCKETS + (top - SUB_BUCKETS);
+}
+
+// Upper edge of a bucket, so percentiles never under-report
+static int64_t bucketValue(int index) {
+    if (index < 2 * SUB_BUCKETS) {
+        return index;
+    }
+
+    int shift = index / SUB_BUCKETS - 1;
+    int64_t top = index % SUB_BUCKETS + SUB_BUCKETS;
+    return ((top + 1) << shift) - 1;
+}
+
+static latency_histogram_t* createHistogram() {
+    latency_histogram_t* histogram = new latency_histogram_t();
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        histogram->buckets[i] = 0;
+    }
+    histogram->count = 0;
+    histogram->max = 0;
+    return histogram;
+}
+
+static latency_histogram_t* getHistogram(latency_stage_t stage, int symbol) {
+    std::atomic<latency_histogram_t*>& slot =
+        histograms[(symbol + 1) * STAGE_COUNT + stage];
+    latency_histogram_t* histogram = slot.load(std::memory_order_acquire);
+    if (histogram != nullptr) {
+        return histogram;
+    }
+
+    // First sample of this symbol and stage, racing recorders keep one
+    latency_histogram_t* created = createHistogram();
+    if (slot.compare_exchange_strong(histogram, created,
+                                     std::memory_order_acq_rel)) {
+        return created;
+    }
+    delete created;
+    return histogram;
+}
+
+static void recordInto(latency_histogram_t* histogram, int64_t micros) {
+    histogram->buckets[bucketIndex(micros)].fetch_add(
+        1, std::memory_order_relaxed);
+    histogram->count.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t max = histogram->max.load(std::memory_order_relaxed);
+    while (micros > max && !histogram->max.compare_exchange_weak(
+                               max, micros, std::memory_order_relaxed)) {
+    }
+}
+
+void Latency::record(latency_stage_t stage, int symbol, int64_t micros) {
+    recordInto(getHistogram(stage, -1), micros);
+    if (symbol >= 0 && symbol < MAX_SYMBOLS) {
+        recordInto(getHistogram(stage, symbol), micros);
+    }
+}
+
+long Latency::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+const char* Latency::stageName(latency_stage_t stage) {
+    return STAGE_NAMES[stage];
+}
+
+latency_summary_t Latency::summarize(latency_stage_t stage, int symbol) {
+    latency_summary_t summary = {0, 0, 0, 0, 0};
+    if (symbol >= MAX_SYMBOLS) {
+        return summary;
+    }
+
+    const latency_histogram_t* histogram =
+        histograms[(symbol + 1) * STAGE_COUNT + stage].load(
+            std::memory_order_acquire);
+    if (histogram == nullptr) {
+        return summary;
+    }
+
+    // Counts keep moving while we read, work from one copy
+    std::vector<uint64_t> counts(LATENCY_BUCKETS);
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        counts[i] = histogram->buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    summary.count = total;
+    summary.max = histogram->max.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return summary;
+    }
+
+    const double quantiles[] = {0.5, 0.99, 0.999};
+    int64_t* targets[] = {&summary.p50, &summary.p99, &summary.p999};
+    uint64_t seen = 0;
+    int q = 0;
+
+    for (int i = 0; i < LATENCY_BUCKETS && q < 3; i++) {
+        seen += counts[i];
+        while (q < 3 && seen >= quantiles[q] * total) {
+            int64_t value = bucketValue(i);
+            *targets[q] = value < summary.max ? value : summary.max;
+            q++;
+        }
+    }
+
+    return summary;
+}
+
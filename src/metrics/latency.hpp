@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+
+typedef enum {
+    STAGE_EXCHANGE_TO_RECEIVE,  // Trade timestamp to first byte received
+    STAGE_RECEIVE_TO_PARSE,     // First byte received to trade parsed
+    STAGE_PARSE_TO_STORE,       // Trade parsed to stored by the ingest thread
+    STAGE_TICK_TO_PUBLISH,      // Minute boundary to indicators published
+    STAGE_HTTP_REQUEST,         // HTTP request handling time
+    STAGE_COUNT
+} latency_stage_t;
+
+// Log-linear histogram in microseconds, 32 sub-buckets per power of two
+// (about 3% relative error), recording with relaxed atomics only
+#define LATENCY_SUB_BITS 5
+#define LATENCY_MAX_SHIFT 31
+#define LATENCY_BUCKETS ((LATENCY_MAX_SHIFT + 2) << LATENCY_SUB_BITS)
+
+typedef struct {
+    std::atomic<uint64_t> buckets[LATENCY_BUCKETS];
+    std::atomic<uint64_t> count;
+    std::atomic<int64_t> max;
+} latency_histogram_t;
+
+typedef struct {
+    uint64_t count;
+    int64_t p50;
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+} latency_summary_t;
+
+namespace Latency {
+
+// Records into the stage's overall histogram and, for a SymbolRegistry id
+// (symbol >= 0), the symbol's own one. Histograms are allocated on first use.
+void record(latency_stage_t stage, int symbol, int64_t micros);
+
+long nowNs();  // Monotonic clock for intervals inside the process
+
+const char* stageName(latency_stage_t stage);
+// symbol -1 summarizes all symbols
+latency_summary_t summarize(latency_stage_t stage, int symbol);
+
+}  // namespace Latency
@@ -0,0 +1,359 @@
+#include "correlation_kernels.hpp"
+
+#include <atomic>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Scalar, in the same order as the loops they replaced
+
+static double sumScalar(const double* x, size_t n) {
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+static void dotsScalar(const double* x, size_t window, const double* y,
+                       double shift, size_t lags, double* out) {
+    for (size_t k = 0; k < lags; k++) {
+        double dot = 0;
+        for (size_t j = 0; j < window; j++) {
+            dot += x[j] * (y[k + j] - shift);
+        }
+        out[k] = dot;
+    }
+}
+
+static void momentsScalar(const double* x, double xMean, const double* y,
+                          double yMean, size_t n, double out[3]) {
+    double xy = 0, xx = 0, yy = 0;
+    for (size_t i = 0; i < n; i++) {
+        double xDiff = x[i] - xMean;
+        double yDiff = y[i] - yMean;
+        xy += xDiff * yDiff;
+        xx += xDiff * xDiff;
+        yy += yDiff * yDiff;
+    }
+    out[0] = xy;
+    out[1] = xx;
+    out[2] = yy;
+}
+
+static void butterfliesScalar(double* re0, double* im0, double* re1,
+                              double* im1, const double* cos,
+                              const double* sin, size_t n) {
+    for (size_t k = 0; k < n; k++) {
+        double vr = re1[k] * cos[k] + im1[k] * sin[k];
+        double vi = im1[k] * cos[k] - re1[k] * sin[k];
+        re1[k] = re0[k] - vr;
+        im1[k] = im0[k] - vi;
+        re0[k] += vr;
+        im0[k] += vi;
+    }
+}
+
+static const correlation_kernels_t SCALAR = {
+    "scalar", sumScalar, dotsScalar, momentsScalar, butterfliesScalar};
+
+#if defined(__x86_64__)
+
+// SSE2 is part of x86-64, two doubles a vector with two accumulators
+
+static double horizontal(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double sumSse2(const double* x, size_t n) {
+    __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a = _mm_add_pd(a, _mm_loadu_pd(x + i));
+        b = _mm_add_pd(b, _mm_loadu_pd(x + i + 2));
+    }
+    double sum = horizontal(_mm_add_pd(a, b));
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+// Two lags a vector, x[j] broadcast, so every lag still adds in j order
+static void dotsSse2(const double* x, size_t window, const double* y,
+                     double shift, size_t lags, double* out) {
+    const __m128d s = _mm_set1_pd(shift);
+    size_t k = 0;
+    for (; k + 4 <= lags; k += 4) {
+        __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+        for (size_t j = 0; j < window; j++) {
+            __m128d xj = _mm_set1_pd(x[j]);
+            __m128d y0 = _mm_sub_pd(_mm_loadu_pd(y + k + j), s);
+            __m128d y1 = _mm_sub_pd(_mm_loadu_pd(y + k + j + 2), s);
+            a = _mm_add_pd(a, _mm_mul_pd(xj, y0));
+            b = _mm_add_pd(b, _mm_mul_pd(xj, y1));
+        }
+        _mm_storeu_pd(out + k, a);
+        _mm_storeu_pd(out + k + 2, b);
+    }
+    dotsScalar(x, window, y + k, shift, lags - k, out + k);
+}
+
+static void momentsSse2(const double* x, double xMean, const double* y,
+                        double yMean, size_t n, double out[3]) {
+    const __m128d xm = _mm_set1_pd(xMean), ym = _mm_set1_pd(yMean);
+    __m128d xy = _mm_setzero_pd(), xx = _mm_setzero_pd(),
+            yy = _mm_setzero_pd();
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d dx = _mm_sub_pd(_mm_loadu_pd(x + i), xm);
+        __m128d dy = _mm_sub_pd(_mm_loadu_pd(y + i), ym);
+        xy = _mm_add_pd(xy, _mm_mul_pd(dx, dy));
+        xx = _mm_add_pd(xx, _mm_mul_pd(dx, dx));
+        yy = _mm_add_pd(yy, _mm_mul_pd(dy, dy));
+    }
+    out[0] = horizontal(xy);
+    out[1] = horizontal(xx);
+    out[2] = horizontal(yy);
+    for (; i < n; i++) {
+        double xDiff = x[i] - xMean;
+        double yDiff = y[i] - yMean;
+        out[0] += xDiff * yDiff;
+        out[1] += xDiff * xDiff;
+        out[2] += yDiff * yDiff;
+    }
+}
+
+static void butterfliesSse2(double* re0, double* im0, double* re1,
+                            double* im1, const double* cos, const double* sin,
+                            size_t n) {
+    size_t k = 0;
+    for (; k + 2 <= n; k += 2) {
+        __m128d c = _mm_loadu_pd(cos + k), s = _mm_loadu_pd(sin + k);
+        __m128d r1 = _mm_loadu_pd(re1 + k), i1 = _mm_loadu_pd(im1 + k);
+        __m128d r0 = _mm_loadu_pd(re0 + k), i0 = _mm_loadu_pd(im0 + k);
+        __m128d vr = _mm_add_pd(_mm_mul_pd(r1, c), _mm_mul_pd(i1, s));
+        __m128d vi = _mm_sub_pd(_mm_mul_pd(i1, c), _mm_mul_pd(r1, s));
+        _mm_storeu_pd(re1 + k, _mm_sub_pd(r0, vr));
+        _mm_storeu_pd(im1 + k, _mm_sub_pd(i0, vi));
+        _mm_storeu_pd(re0 + k, _mm_add_pd(r0, vr));
+        _mm_storeu_pd(im0 + k, _mm_add_pd(i0, vi));
+    }
+    butterfliesScalar(re0 + k, im0 + k, re1 + k, im1 + k, cos + k, sin + k,
+                      n - k);
+}
+
+static const correlation_kernels_t SSE2 = {"sse2", sumSse2, dotsSse2,
+                                           momentsSse2, butterfliesSse2};
+
+// AVX2 with FMA, four doubles a vector. Compiled for the instruction set on
+// its own so the rest of the binary still runs on any x86-64.
+
+#define AVX2 __attribute__((target("avx2,fma")))
+
+AVX2 static double horizontal256(__m256d v) {
+    return horizontal(
+        _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+}
+
+AVX2 static double sumAvx2(const double* x, size_t n) {
+    __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a = _mm256_add_pd(a, _mm256_loadu_pd(x + i));
+        b = _mm256_add_pd(b, _mm256_loadu_pd(x + i + 4));
+    }
+    double sum = horizontal256(_mm256_add_pd(a, b));
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+AVX2 static void dotsAvx2(const double* x, size_t window, const double* y,
+                          double shift, size_t lags, double* out) {
+    const __m256d s = _mm256_set1_pd(shift);
+    size_t k = 0;
+    for (; k + 8 <= lags; k += 8) {
+        __m256d a = _mm256_setzero_pd(), b = _mm256_setzero_pd();
+        for (size_t j = 0; j < window; j++) {
+            __m256d xj = _mm256_set1_pd(x[j]);
+            __m256d y0 = _mm256_sub_pd(_mm256_loadu_pd(y + k + j), s);
+            __m256d y1 = _mm256_sub_pd(_mm256_loadu_pd(y + k + j + 4), s);
+            a = _mm256_fmadd_pd(xj, y0, a);
+            b = _mm256_fmadd_pd(xj, y1, b);
+        }
+        _mm256_storeu_pd(out + k, a);
+        _mm256_storeu_pd(out + k + 4, b);
+    }
+    dotsScalar(x, window, y + k, shift, lags - k, out + k);
+}
+
+AVX2 static void momentsAvx2(const double* x, double xMean, const double* y,
+                             double yMean, size_t n, double out[3]) {
+    const __m256d xm = _mm256_set1_pd(xMean), ym = _mm256_set1_pd(yMean);
+    __m256d xy = _mm256_setzero_pd(), xx = _mm256_setzero_pd(),
+            yy = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(x + i), xm);
+        __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(y + i), ym);
+        xy = _mm256_fmadd_pd(dx, dy, xy);
+        xx = _mm256_fmadd_pd(dx, dx, xx);
+        yy = _mm256_fmadd_pd(dy, dy, yy);
+    }
+    out[0] = horizontal256(xy);
+    out[1] = horizontal256(xx);
+    out[2] = horizontal256(yy);
+    for (; i < n; i++) {
+        double xDiff = x[i] - xMean;
+        double yDiff = y[i] - yMean;
+        out[0] += xDiff * yDiff;
+        out[1] += xDiff * xDiff;
+        out[2] += yDiff * yDiff;
+    }
+}
+
+AVX2 static void butterfliesAvx2(double* re0, double* im0, double* re1,
+                                 double* im1, const double* cos,
+                                 const double* sin, size_t n) {
+    size_t k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d c = _mm256_loadu_pd(cos + k), s = _mm256_loadu_pd(sin + k);
+        __m256d r1 = _mm256_loadu_pd(re1 + k), i1 = _mm256_loadu_pd(im1 + k);
+        __m256d r0 = _mm256_loadu_pd(re0 + k), i0 = _mm256_loadu_pd(im0 + k);
+        __m256d vr = _mm256_fmadd_pd(r1, c, _mm256_mul_pd(i1, s));
+        __m256d vi = _mm256_fmsub_pd(i1, c, _mm256_mul_pd(r1, s));
+        _mm256_storeu_pd(re1 + k, _mm256_sub_pd(r0, vr));
+        _mm256_storeu_pd(im1 + k, _mm256_sub_pd(i0, vi));
+        _mm256_storeu_pd(re0 + k, _mm256_add_pd(r0, vr));
+        _mm256_storeu_pd(im0 + k, _mm256_add_pd(i0, vi));
+    }
+    butterfliesScalar(re0 + k, im0 + k, re1 + k, im1 + k, cos + k, sin + k,
+                      n - k);
+}
+
+static const correlation_kernels_t AVX2_FMA = {
+    "avx2", sumAvx2, dotsAvx2, momentsAvx2, butterfliesAvx2};
+
+#elif defined(__aarch64__)
+
+// NEON is part of AArch64, two doubles a vector with two accumulators
+
+static double sumNeon(const double* x, size_t n) {
+    float64x2_t a = vdupq_n_f64(0), b = vdupq_n_f64(0);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a = vaddq_f64(a, vld1q_f64(x + i));
+        b = vaddq_f64(b, vld1q_f64(x + i + 2));
+    }
+    double sum = vaddvq_f64(vaddq_f64(a, b));
+    for (; i < n; i++) {
+        sum += x[i];
+    }
+    return sum;
+}
+
+static void dotsNeon(const double* x, size_t window, const double* y,
+                     double shift, size_t lags, double* out) {
+    const float64x2_t s = vdupq_n_f64(shift);
+    size_t k = 0;
+    for (; k + 4 <= lags; k += 4) {
+        float64x2_t a = vdupq_n_f64(0), b = vdupq_n_f64(0);
+        for (size_t j = 0; j < window; j++) {
+            float64x2_t xj = vdupq_n_f64(x[j]);
+            float64x2_t y0 = vsubq_f64(vld1q_f64(y + k + j), s);
+            float64x2_t y1 = vsubq_f64(vld1q_f64(y + k + j + 2), s);
+            a = vfmaq_f64(a, xj, y0);
+            b = vfmaq_f64(b, xj, y1);
+        }
+        vst1q_f64(out + k, a);
+        vst1q_f64(out + k + 2, b);
+    }
+    dotsScalar(x, window, y + k, shift, lags - k, out + k);
+}
+
+static void momentsNeon(const double* x, double xMean, const double* y,
+                        double yMean, size_t n, double out[3]) {
+    const float64x2_t xm = vdupq_n_f64(xMean), ym = vdupq_n_f64(yMean);
+    float64x2_t xy = vdupq_n_f64(0), xx = vdupq_n_f64(0), yy = vdupq_n_f64(0);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t dx = vsubq_f64(vld1q_f64(x + i), xm);
+        float64x2_t dy = vsubq_f64(vld1q_f64(y + i), ym);
+        xy = vfmaq_f64(xy, dx, dy);
+        xx = vfmaq_f64(xx, dx, dx);
+        yy = vfmaq_f64(yy, dy, dy);
+    }
+    out[0] = vaddvq_f64(xy);
+    out[1] = vaddvq_f64(xx);
+    out[2] = vaddvq_f64(yy);
+    for (; i < n; i++) {
+        double xDiff = x[i] - xMean;
+        double yDiff = y[i] - yMean;
+        out[0] += xDiff * yDiff;
+        out[1] += xDiff * xDiff;
+        out[2] += yDiff * yDiff;
+    }
+}
+
+static void butterfliesNeon(double* re0, double* im0, double* re1,
+                            double* im1, const double* cos, const double* sin,
+                            size_t n) {
+    size_t k = 0;
+    for (; k + 2 <= n; k += 2) {
+        float64x2_t c = vld1q_f64(cos + k), s = vld1q_f64(sin + k);
+        float64x2_t r1 = vld1q_f64(re1 + k), i1 = vld1q_f64(im1 + k);
+        float64x2_t r0 = vld1q_f64(re0 + k), i0 = vld1q_f64(im0 + k);
+        float64x2_t vr = vfmaq_f64(vmulq_f64(i1, s), r1, c);
+        float64x2_t vi = vfmsq_f64(vmulq_f64(i1, c), r1, s);
+        vst1q_f64(re1 + k, vsubq_f64(r0, vr));
+        vst1q_f64(im1 + k, vsubq_f64(i0, vi));
+        vst1q_f64(re0 + k, vaddq_f64(r0, vr));
+        vst1q_f64(im0 + k, vaddq_f64(i0, vi));
+    }
+    butterfliesScalar(re0 + k, im0 + k, re1 + k, im1 + k, cos + k, sin + k,
+                      n - k);
+}
+
+static const correlation_kernels_t NEON = {"neon", sumNeon, dotsNeon,
+                                           momentsNeon, butterfliesNeon};
+
+#endif
+
+std::vector<const correlation_kernels_t*> CorrelationKernels::available() {
+    std::vector<const correlation_kernels_t*> kernels = {&SCALAR};
+#if defined(__x86_64__)
+    kernels.push_back(&SSE2);
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        kernels.push_back(&AVX2_FMA);
+    }
+#elif defined(__aarch64__)
+    kernels.push_back(&NEON);
+#endif
+    return kernels;
+}
+
+// The last of available(), until select() says otherwise
+static std::atomic<const correlation_kernels_t*>& current() {
+    static std::atomic<const correlation_kernels_t*> kernels(
+        CorrelationKernels::available().back());
+    return kernels;
+}
+
+const correlation_kernels_t& CorrelationKernels::active() {
+    return *current().load(std::memory_order_relaxed);
+}
+
+bool CorrelationKernels::select(const std::string& name) {
+    for (const correlation_kernels_t* kernels : available()) {
+        if (name == kernels->name) {
+            current().store(kernels, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
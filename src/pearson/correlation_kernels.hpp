@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// The loops Pearson spends its time in, once per instruction set.
+// Vector sums and moments add in a different order than scalar and dots may
+// fuse multiply-adds, so results agree to rounding, not bit for bit.
+typedef struct {
+    const char* name;  // "scalar", "sse2", "avx2", "neon"
+
+    double (*sum)(const double* x, size_t n);
+    // out[k] = sum of x[j] * (y[k + j] - shift) over j < window, for every
+    // lag k < lags: one window against lags windows of y
+    void (*dots)(const double* x, size_t window, const double* y, double shift,
+                 size_t lags, double* out);
+    // Sums of (x - xMean)(y - yMean), (x - xMean)² and (y - yMean)²
+    void (*moments)(const double* x, double xMean, const double* y,
+                    double yMean, size_t n, double out[3]);
+    // One run of radix-2 FFT butterflies: for k < n, v = (re1 + i im1)
+    // (cos - i sin), then re0 + i im0 gains v and re1 + i im1 becomes the
+    // old re0 + i im0 minus v
+    void (*butterflies)(double* re0, double* im0, double* re1, double* im1,
+                        const double* cos, const double* sin, size_t n);
+} correlation_kernels_t;
+
+namespace CorrelationKernels {
+
+// The fastest kernels this CPU runs, picked on first use
+const correlation_kernels_t& active();
+
+// Every kernel this CPU runs, scalar first
+std::vector<const correlation_kernels_t*> available();
+
+// Makes name the active kernel, false if this CPU cannot run it
+bool select(const std::string& name);
+
+}  // namespace CorrelationKernels
@@ -0,0 +1,147 @@
+#include "fft.hpp"
+
+#include <cmath>
+#include <utility>
+
+#include "correlation_kernels.hpp"
+
+size_t Fft::sizeFor(size_t n) {
+    size_t size = 4;
+    while (size < n) {
+        size *= 2;
+    }
+    return size;
+}
+
+void Fft::plan(size_t size, fft_plan_t& out) {
+    const size_t half = size / 2;
+    out.size = size;
+    out.cos.resize(half);
+    out.sin.resize(half);
+    for (size_t k = 0; k < half; k++) {
+        // Each angle on its own, a recurrence would add up rounding
+        double angle = 2 * M_PI * k / size;
+        out.cos[k] = cos(angle);
+        out.sin[k] = sin(angle);
+    }
+
+    out.stageCos.clear();
+    out.stageSin.clear();
+    for (size_t length = 2; length <= half; length *= 2) {
+        for (size_t j = 0; j < length / 2; j++) {
+            out.stageCos.push_back(out.cos[j * (size / length)]);
+            out.stageSin.push_back(out.sin[j * (size / length)]);
+        }
+    }
+
+    out.reversed.resize(half);
+    size_t bits = 0;
+    while (((size_t)1 << bits) < half) {
+        bits++;
+    }
+    for (size_t i = 0; i < half; i++) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        out.reversed[i] = r;
+    }
+}
+
+// In-place radix-2 forward complex FFT of size / 2 points. Swapping re and
+// im makes it the inverse, unscaled.
+static void complexTransform(const fft_plan_t& plan, double* re, double* im) {
+    const size_t n = plan.size / 2;
+    for (size_t i = 0; i < n; i++) {
+        size_t j = plan.reversed[i];
+        if (i < j) {
+            std::swap(re[i], re[j]);
+            std::swap(im[i], im[j]);
+        }
+    }
+
+    // The first stage needs no twiddles
+    for (size_t i = 0; i + 1 < n; i += 2) {
+        double vr = re[i + 1], vi = im[i + 1];
+        re[i + 1] = re[i] - vr;
+        im[i + 1] = im[i] - vi;
+        re[i] += vr;
+        im[i] += vi;
+    }
+
+    const correlation_kernels_t& kernels = CorrelationKernels::active();
+    for (size_t length = 4; length <= n; length *= 2) {
+        const size_t half = length / 2;
+        const double* cosines = plan.stageCos.data() + half - 1;
+        const double* sines = plan.stageSin.data() + half - 1;
+        for (size_t start = 0; start < n; start += length) {
+            double* re0 = re + start;
+            double* im0 = im + start;
+            kernels.butterflies(re0, im0, re0 + half, im0 + half, cosines,
+                                sines, half);
+        }
+    }
+}
+
+void Fft::forward(const fft_plan_t& plan, const double* x, size_t n,
+                  double offset, fft_spectrum_t& out) {
+    const size_t half = plan.size / 2;
+    out.re.resize(half + 1);
+    out.im.resize(half + 1);
+    double* re = out.re.data();
+    double* im = out.im.data();
+
+    // Even points as the real part, odd ones as the imaginary part
+    for (size_t i = 0; i < half; i++) {
+        re[i] = 2 * i < n ? x[2 * i] - offset : 0;
+        im[i] = 2 * i + 1 < n ? x[2 * i + 1] - offset : 0;
+    }
+    complexTransform(plan, re, im);
+
+    // Untangle the spectra of the even and odd points, E and O, a bin and its
+    // mirror at a time: X[k] = E + w^k O and X[half - k] = conj(E - w^k O)
+    re[half] = re[0];
+    im[half] = im[0];
+    for (size_t k = 0; k <= half / 2; k++) {
+        size_t m = half - k;
+        double er = (re[k] + re[m]) / 2, ei = (im[k] - im[m]) / 2;
+        double or_ = (im[k] + im[m]) / 2, oi = -(re[k] - re[m]) / 2;
+        double wr = plan.cos[k], wi = -plan.sin[k];
+        double tr = wr * or_ - wi * oi, ti = wr * oi + wi * or_;
+        re[k] = er + tr;
+        im[k] = ei + ti;
+        re[m] = er - tr;
+        im[m] = -(ei - ti);
+    }
+}
+
+void Fft::inverse(const fft_plan_t& plan, fft_spectrum_t& spectrum,
+                  double* out) {
+    const size_t half = plan.size / 2;
+    double* re = spectrum.re.data();
+    double* im = spectrum.im.data();
+
+    // Back to the spectra of the even and odd points, Z = E + i O with
+    // E = (X[k] + conj X[m]) / 2 and O = (X[k] - conj X[m]) / 2 w^-k, where
+    // Z[m] = conj E + i conj O
+    for (size_t k = 0; k <= half / 2; k++) {
+        size_t m = half - k;
+        double er = (re[k] + re[m]) / 2, ei = (im[k] - im[m]) / 2;
+        double dr = (re[k] - re[m]) / 2, di = (im[k] + im[m]) / 2;
+        double wr = plan.cos[k], wi = plan.sin[k];
+        double or_ = dr * wr - di * wi, oi = dr * wi + di * wr;
+        re[k] = er - oi;
+        im[k] = ei + or_;
+        if (m < half) {
+            re[m] = er + oi;
+            im[m] = -ei + or_;
+        }
+    }
+    complexTransform(plan, im, re);
+
+    const double scale = 1.0 / half;
+    for (size_t i = 0; i < half; i++) {
+        out[2 * i] = re[i] * scale;
+        out[2 * i + 1] = im[i] * scale;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Real FFT of a power of two size, through a complex FFT of half that size
+typedef struct {
+    size_t size;
+    std::vector<double> cos, sin;  // Of 2 pi k / size, k < size / 2
+    std::vector<size_t> reversed;  // Bit reversal permutation of size / 2
+    // The same angles stage by stage of the half size transform, so each
+    // reads them in order: length l's l / 2 start at l / 2 - 1
+    std::vector<double> stageCos, stageSin;
+} fft_plan_t;
+
+// The size / 2 + 1 bins of a real signal, the rest mirror them
+typedef struct {
+    std::vector<double> re, im;
+} fft_spectrum_t;
+
+namespace Fft {
+
+// The smallest size of at least n points
+size_t sizeFor(size_t n);
+void plan(size_t size, fft_plan_t& out);
+
+// Spectrum of x[0, n) - offset, padded with zeros to the plan's size.
+// Reuses the storage of out.
+void forward(const fft_plan_t& plan, const double* x, size_t n,
+             double offset, fft_spectrum_t& out);
+// The plan's size points whose spectrum this is. Overwrites spectrum.
+void inverse(const fft_plan_t& plan, fft_spectrum_t& spectrum, double* out);
+
+}  // namespace Fft
@@ -3,29 +3,92 @@
 #include <pthread.h>
 
 #include <chrono>
+#include <cfloat>
 #include <cmath>
 #include <cstdio>
+#include <deque>
 #include <iostream>
 
 #include "../data_collector/data_collector.hpp"
+#include "../indicators/indicator_engine.hpp"
 #include "../scheduler/scheduler.hpp"
+#include "../universe/universe.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/file_writer.hpp"
+#include "../utils/symbol_registry.hpp"
+#include "../utils/worker_pool.hpp"
+#include "correlation_kernels.hpp"
+
+// The newest averages of a symbol are correlated against every stretch of
+// this length of the others, never fewer than PEARSON_MIN_POINTS points
+static long pearsonWindowMs = 8 * 60 * 1000;  // 8 minutes
+static const long PEARSON_MAX_WINDOW_MS = 24 * 60 * 60 * 1000;
+static const size_t PEARSON_MIN_POINTS = 8;
+
+// Lags a lag scan hands the correlation kernels at once
+static const size_t DOT_BLOCK = 64;
+
+// Points times window above which the FFT scan beats the kernels, see
+// bench/correlation_bench
+static const size_t FFT_MIN_WORK = 4320 * 72;
+// Rows a pool run scans. Runs take the pool in turn, so an indicator tick
+// queued behind Pearson waits for the one run in progress, and the FFT keeps
+// the transforms of that many windows, 4 MB at 3 days of minutes.
+static const size_t PEARSON_ROWS = 64;
+// Correlations the FFT's rounding may be off by before a lag is redone with
+// the kernels, as in a window much quieter than the whole series
+static const double FFT_TOLERANCE = 1e-10;
+
+// A matrix of 500 symbols is 1.5 MB
+const size_t Pearson::MATRIX_HISTORY = 15;
+
+static std::deque<pearson_matrix_t> matrices;  // Newest first
+static pthread_mutex_t matricesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Pearson runs on one point per minute, or per bar for longer bars, so
+// shorter bars do not multiply its cost. Keeps the newest count points of
+// recent that fall on a minute boundary, all of them for 0.
+static void keepMinutes(value_t& recent, size_t count) {
+    size_t kept = 0;
+    for (size_t i = 0; i < recent.values.size(); i++) {
+        if (Scheduler::isMinuteTick(recent.timestamps[i])) {
+            recent.values[kept] = recent.values[i];
+            recent.timestamps[kept] = recent.timestamps[i];
+            kept++;
+        }
+    }
+    recent.values.resize(kept);
+    recent.timestamps.resize(kept);
+
+    if (count > 0 && kept > count) {
+        recent.values.erase(recent.values.begin(),
+                            recent.values.end() - count);
+        recent.timestamps.erase(recent.timestamps.begin(),
+                                recent.timestamps.end() - count);
+    }
+}
 
-void Pearson::writePearsonToFile(std::string symbol1, std::string symbol2,
-                                 double pearson, long timestamp,
-                                 long maxTimestamp, int delay) {
-    std::string filename = "data/pearson.txt";
-
-    // open the file for writing
-    FILE* fp = fopen(filename.c_str(), "a");
-    if (fp == NULL) {
-        std::cout << "Error opening the file " << filename << std::endl;
-        return;
+bool Pearson::setWindow(long ms) {
+    if (ms <= 0 || ms % Scheduler::MINUTE_MS != 0 ||
+        ms > PEARSON_MAX_WINDOW_MS) {
+        return false;
     }
+    pearsonWindowMs = ms;
+    return true;
+}
+
+long Pearson::windowMs() { return pearsonWindowMs; }
+
+void Pearson::writePearsonToFile(int symbol1, int symbol2, double pearson,
+                                 long timestamp, long maxTimestamp,
+                                 int delay) {
+    static const int pearsonFile = FileWriter::open("data/pearson.txt");
 
-    // write to the text file
-    fprintf(fp, "%s %s %.6f %ld %ld %d\n", symbol1.c_str(), symbol2.c_str(),
-            pearson, maxTimestamp, timestamp, delay);
-    fclose(fp);
+    // queue the line for the writer thread
+    FileWriter::format(pearsonFile, "%s %s %.6f %ld %ld %d\n",
+                       SymbolRegistry::name(symbol1).c_str(),
+                       SymbolRegistry::name(symbol2).c_str(), pearson,
+                       maxTimestamp, timestamp, delay);
 }
 
 double Pearson::calculatePearson(const std::vector<double>& x,
@@ -40,26 +103,15 @@ double Pearson::calculatePearson(const std::vector<double>& x,
         return 0;
     }
 
-    // Calculate means
-    double xMean = 0, yMean = 0;
-    for (size_t i = 0; i < n; i++) {
-        xMean += x[i];
-        yMean += y[i];
-    }
-    xMean /= n;
-    yMean /= n;
-
-    double numerator = 0;
-    double xDenominator = 0;
-    double yDenominator = 0;
+    const correlation_kernels_t& kernels = CorrelationKernels::active();
+    double xMean = kernels.sum(x.data(), n) / n;
+    double yMean = kernels.sum(y.data(), n) / n;
 
-    for (size_t i = 0; i < n; i++) {
-        double xDiff = x[i] - xMean;
-        double yDiff = y[i] - yMean;
-        numerator += xDiff * yDiff;
-        xDenominator += xDiff * xDiff;
-        yDenominator += yDiff * yDiff;
-    }
+    double moments[3];
+    kernels.moments(x.data(), xMean, y.data(), yMean, n, moments);
+    double numerator = moments[0];
+    double xDenominator = moments[1];
+    double yDenominator = moments[2];
 
     if (xDenominator == 0 || yDenominator == 0) {
         return 0;
@@ -69,97 +121,408 @@ double Pearson::calculatePearson(const std::vector<double>& x,
     return correlation;
 }
 
-size_t findMaximumIndex(const std::vector<double>& arr) {
-    if (arr.empty()) return 0;
+void Pearson::normalizeWindow(const double* x, size_t window,
+                              pearson_window_t& out) {
+    double mean = 0;
+    for (size_t i = 0; i < window; i++) {
+        mean += x[i];
+    }
+    mean /= window;
+
+    double squares = 0;
+    out.values.resize(window);
+    for (size_t i = 0; i < window; i++) {
+        out.values[i] = x[i] - mean;
+        squares += out.values[i] * out.values[i];
+    }
+
+    // A flat window stays all zeros and correlates 0 with everything
+    double scale = squares > 0 ? 1 / sqrt(squares) : 0;
+    out.sum = 0;
+    for (size_t i = 0; i < window; i++) {
+        out.values[i] *= scale;
+        out.sum += out.values[i];
+    }
+}
+
+// Mean and squared deviations of y[0, window) - reference, two passes like
+// calculatePearson
+static void windowMoments(const double* y, size_t window, double reference,
+                          double& mean, double& squares) {
+    mean = 0;
+    for (size_t i = 0; i < window; i++) {
+        mean += y[i] - reference;
+    }
+    mean /= window;
 
-    double max = arr[0];
-    size_t maxIndex = 0;
+    squares = 0;
+    for (size_t i = 0; i < window; i++) {
+        double diff = y[i] - reference - mean;
+        squares += diff * diff;
+    }
+}
 
-    for (size_t i = 1; i < arr.size(); i++) {
-        if (arr[i] > max) {
-            maxIndex = i;
-            max = arr[i];
+void Pearson::normalizeLags(const double* y, size_t n, size_t window,
+                            pearson_lags_t& out) {
+    const size_t lags = n >= window && window > 0 ? n - window + 1 : 0;
+    out.window = window;
+    out.offsets.resize(lags);
+    out.scales.resize(lags);
+    if (lags == 0) {
+        return;
+    }
+
+    // Neighbours in the window that differ, none means y is flat there
+    size_t changes = 0;
+    for (size_t i = 0; i + 1 < window; i++) {
+        changes += y[i] != y[i + 1];
+    }
+
+    // Moments of y relative to a nearby point, so rounding scales with how
+    // far y moves rather than with its level
+    double reference = 0, mean = 0, squares = 0, peak = 0;
+    size_t sinceRestart = 0;
+    for (size_t i = 0; i < lags; i++, sinceRestart++) {
+        // Slide one point: y[i - 1] leaves, y[i + window - 1] enters
+        if (i > 0 && window > 1) {
+            changes -= y[i - 1] != y[i];
+            changes += y[i + window - 2] != y[i + window - 1];
+        }
+
+        bool restart = i == 0 || sinceRestart == window;
+        if (!restart) {
+            // Welford's update, stable where the sums of y and y² are not
+            double leaving = y[i - 1] - reference;
+            double entering = y[i + window - 1] - reference;
+            double delta = entering - leaving;
+            double previous = mean;
+            mean += delta / window;
+            squares += delta * (entering - mean + leaving - previous);
+
+            // Start over now and then so rounding does not build up, and
+            // once the window is much quieter than what it was relative to
+            peak = squares > peak ? squares : peak;
+            restart = squares < peak * 1e-6;
+        }
+        if (restart) {
+            reference = y[i];
+            windowMoments(y + i, window, reference, mean, squares);
+            peak = squares;
+            sinceRestart = 0;
         }
+
+        // scanLags takes the dot products relative to the first point of
+        // each DOT_BLOCK lags
+        double shift = y[i - i % DOT_BLOCK];
+        out.offsets[i] = reference - shift + mean;
+        out.scales[i] = changes > 0 && squares > 0 ? 1 / sqrt(squares) : 0;
     }
+}
+
+void Pearson::scanLags(const pearson_window_t& x, const double* y,
+                       const pearson_lags_t& lags, size_t count,
+                       double* out) {
+    const size_t window = x.values.size();
+    const correlation_kernels_t& kernels = CorrelationKernels::active();
 
-    return maxIndex;
+    for (size_t i = 0; i < count; i += DOT_BLOCK) {
+        size_t block = count - i < DOT_BLOCK ? count - i : DOT_BLOCK;
+        kernels.dots(x.values.data(), window, y + i, y[i], block, out + i);
+    }
+
+    // x is centered, so y's mean only enters through what rounding left of
+    // x's sum
+    const double* offsets = lags.offsets.data();
+    const double* scales = lags.scales.data();
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (out[i] - offsets[i] * x.sum) * scales[i];
+    }
 }
 
-void* Pearson::calculateAllPearson(void* arg) {
-    calculatePearsonArgs* args = (calculatePearsonArgs*)arg;
-    const long currentTimestamp = args->timestampInMs;
-    const std::vector<std::string>& SYMBOLS = args->SYMBOLS;
-    const int PEARSON_WINDOW = 8;
+void Pearson::transformWindow(const fft_plan_t& plan, pearson_window_t& x) {
+    Fft::forward(plan, x.values.data(), x.values.size(), 0, x.spectrum);
+}
 
-    for (const auto& symbol1 : SYMBOLS) {
-        std::vector<double> averages1 =
-            DataCollector::getRecentAverages(symbol1, currentTimestamp,
-                                             PEARSON_WINDOW)
-                .values;
+void Pearson::transformLags(const fft_plan_t& plan, const double* y,
+                            size_t n, pearson_lags_t& lags) {
+    // Relative to its mean, y's level does not swamp the window's moves
+    double level = 0;
+    for (size_t i = 0; i < n; i++) {
+        level += y[i];
+    }
+    level = n > 0 ? level / n : 0;
+
+    double squares = 0;
+    for (size_t i = 0; i < n; i++) {
+        squares += (y[i] - level) * (y[i] - level);
+    }
 
-        if (averages1.size() < PEARSON_WINDOW) {
-            return nullptr;
+    lags.level = level;
+    Fft::forward(plan, y, n, level, lags.spectrum);
+    // Against a window of unit length, a few ulps per butterfly stage
+    lags.fftError = 4 * DBL_EPSILON * log2((double)plan.size) * sqrt(squares);
+}
+
+void Pearson::scanLagsFft(const pearson_window_t& x, const double* y,
+                          const pearson_lags_t& lags, size_t count,
+                          const fft_plan_t& plan, fft_spectrum_t& product,
+                          double* out) {
+    // Cross-correlation is the inverse of conj(X) Y
+    const size_t bins = plan.size / 2 + 1;
+    product.re.resize(bins);
+    product.im.resize(bins);
+    const double* xr = x.spectrum.re.data();
+    const double* xi = x.spectrum.im.data();
+    const double* yr = lags.spectrum.re.data();
+    const double* yi = lags.spectrum.im.data();
+    for (size_t k = 0; k < bins; k++) {
+        product.re[k] = xr[k] * yr[k] + xi[k] * yi[k];
+        product.im[k] = xr[k] * yi[k] - xi[k] * yr[k];
+    }
+    Fft::inverse(plan, product, out);
+
+    // out[i] is now relative to the series' level rather than to the block's
+    // first point like the offsets are
+    const size_t window = x.values.size();
+    const correlation_kernels_t& kernels = CorrelationKernels::active();
+    const double* offsets = lags.offsets.data();
+    const double* scales = lags.scales.data();
+    for (size_t i = 0; i < count; i++) {
+        double shift = y[i - i % DOT_BLOCK];
+        if (scales[i] * lags.fftError > FFT_TOLERANCE) {
+            kernels.dots(x.values.data(), window, y + i, shift, 1, out + i);
+        } else {
+            out[i] -= (shift - lags.level) * x.sum;
         }
+        out[i] = (out[i] - offsets[i] * x.sum) * scales[i];
+    }
+}
 
-        std::vector<double> pearsonValues;
-        std::vector<long> slidingTimestamps;
-        std::vector<std::string> symbol2arr;
+bool Pearson::prefersFft(size_t n, size_t window) {
+    return n * window > FFT_MIN_WORK;
+}
 
-        for (const auto& symbol2 : SYMBOLS) {
-            std::vector<double> averages2 =
-                DataCollector::getRecentAverages(symbol2, currentTimestamp)
-                    .values;
+// One calculateAllPearson run, shared by its pool tasks. Each task writes
+// only its own symbol's or column's entries.
+typedef struct {
+    const std::vector<int>* symbols;
+    long stepMs;
+    size_t window;
+    bool fft;
+    fft_plan_t plan;
+
+    std::vector<value_t> recent;            // Minute points of every symbol
+    std::vector<pearson_window_t> windows;  // Latest window of every row
+    std::vector<long> windowStarts;
+    size_t firstRow, lastRow;               // Rows of the current pool run
+
+    // Every pair's best correlation, NAN if none, and where its window starts
+    std::vector<double> maxima;
+    std::vector<long> starts;
+    pearson_matrix_t matrix;
+} pearson_job_t;
+
+// Whether symbol s has a full window to correlate
+static bool hasWindow(const pearson_job_t& job, size_t s) {
+    return job.recent[s].values.size() >= job.window;
+}
 
-            const size_t n = averages2.size();
+static void prepareSymbol(size_t s, void* arg) {
+    pearson_job_t& job = *(pearson_job_t*)arg;
+    value_t& points = job.recent[s];
+    points = DataCollector::getRecent(INDICATOR_SMA, (*job.symbols)[s]);
+    keepMinutes(points, 0);
+    if (!hasWindow(job, s)) {
+        return;  // Only this row stays empty
+    }
 
-            int numOfSlides;
-            if (symbol1 != symbol2) {
-                numOfSlides = n - PEARSON_WINDOW + 1;
-            } else {
-                numOfSlides = n - PEARSON_WINDOW - 1;
-            }
+    size_t first = points.values.size() - job.window;
+    Pearson::normalizeWindow(points.values.data() + first, job.window,
+                             job.windows[s]);
+    // A point is stamped with the end of its step
+    job.windowStarts[s] = points.timestamps[first] - job.stepMs;
+}
 
-            if (numOfSlides <= 0) continue;
+static void transformRow(size_t index, void* arg) {
+    pearson_job_t& job = *(pearson_job_t*)arg;
+    size_t s1 = job.firstRow + index;
+    if (hasWindow(job, s1)) {
+        Pearson::transformWindow(job.plan, job.windows[s1]);
+    }
+}
 
-            for (int i = 0; i < numOfSlides; i++) {
-                std::vector<double> averagesSlice2(
-                    averages2.begin() + i,
-                    averages2.begin() + i + PEARSON_WINDOW);
+// Column s2 against the rows of the current run, so its history is
+// normalized once for all of them
+static void scanColumn(size_t s2, void* arg) {
+    pearson_job_t& job = *(pearson_job_t*)arg;
+    const size_t count = job.recent.size();
+    const std::vector<double>& averages2 = job.recent[s2].values;
+    const size_t n = averages2.size();
+    if (n < job.window) {
+        return;
+    }
+
+    pearson_lags_t lags;
+    Pearson::normalizeLags(averages2.data(), n, job.window, lags);
+    const bool columnFft = job.fft && Pearson::prefersFft(n, job.window);
+    if (columnFft) {
+        Pearson::transformLags(job.plan, averages2.data(), n, lags);
+    }
+    fft_spectrum_t product;
+    std::vector<double> pearsonValues(columnFft ? job.plan.size : n);
 
-                double pearsonValue =
-                    calculatePearson(averages1, averagesSlice2);
+    for (size_t s1 = job.firstRow; s1 < job.lastRow; s1++) {
+        if (!hasWindow(job, s1)) continue;
 
-                pearsonValues.push_back(pearsonValue);
+        int numOfSlides;
+        if (s1 != s2) {
+            numOfSlides = n - job.window + 1;
+        } else {
+            numOfSlides = n - job.window - 1;
+        }
 
-                // Starting timestamp of window
-                const long slideTimestamp =
-                    currentTimestamp - averages2.size() * 60000 + i * 60000;
+        if (numOfSlides <= 0) continue;
 
-                slidingTimestamps.push_back(slideTimestamp);
-                symbol2arr.push_back(symbol2);
+        if (columnFft) {
+            Pearson::scanLagsFft(job.windows[s1], averages2.data(), lags,
+                                 numOfSlides, job.plan, product,
+                                 pearsonValues.data());
+        } else {
+            Pearson::scanLags(job.windows[s1], averages2.data(), lags,
+                              numOfSlides, pearsonValues.data());
+        }
+
+        int maximumIndex = 0;
+        for (int i = 1; i < numOfSlides; i++) {
+            if (pearsonValues[i] > pearsonValues[maximumIndex]) {
+                maximumIndex = i;
             }
         }
+        double maximum = pearsonValues[maximumIndex];
+        // Starting timestamp of window, a point is stamped with the end of
+        // its step
+        long windowStart =
+            job.recent[s2].timestamps[maximumIndex] - job.stepMs;
+
+        size_t cell = s1 * count + s2;
+        job.maxima[cell] = maximum;
+        job.starts[cell] = windowStart;
+        job.matrix.correlations[cell] = maximum;
+        job.matrix.lags[cell] =
+            (job.windowStarts[s1] - windowStart) / job.stepMs;
+    }
+}
+
+void* Pearson::calculateAllPearson(void* arg) {
+    calculatePearsonArgs* args = (calculatePearsonArgs*)arg;
+    const long currentTimestamp = args->timestampInMs;
+    const std::vector<int>& SYMBOLS = args->SYMBOLS;
+    const size_t count = SYMBOLS.size();
+    const long barMs = IndicatorEngine::barMs();
+
+    pearson_job_t job;
+    job.symbols = &SYMBOLS;
+    job.stepMs = barMs > Scheduler::MINUTE_MS ? barMs : Scheduler::MINUTE_MS;
+    job.window = pearsonWindowMs / job.stepMs > (long)PEARSON_MIN_POINTS
+                     ? pearsonWindowMs / job.stepMs
+                     : PEARSON_MIN_POINTS;
+    job.recent.resize(count);
+    job.windows.resize(count);
+    job.windowStarts.resize(count);
+    job.maxima.assign(count * count, NAN);
+    job.starts.assign(count * count, 0);
+
+    job.matrix.timestamp = currentTimestamp;
+    job.matrix.stepMs = job.stepMs;
+    job.matrix.window = job.window;
+    job.matrix.symbols = SYMBOLS;
+    job.matrix.correlations.assign(count * count, NAN);
+    job.matrix.lags.assign(count * count, -1);
+
+    // Every symbol's points are copied and its latest window normalized
+    // once per run, not once per pair
+    WorkerPool::run(count, prepareSymbol, &job);
+
+    size_t longest = 0;
+    for (size_t s = 0; s < count; s++) {
+        if (job.recent[s].values.size() > longest) {
+            longest = job.recent[s].values.size();
+        }
+    }
+    // Long windows over long histories go through the FFT
+    job.fft = prefersFft(longest, job.window);
+    if (job.fft) {
+        Fft::plan(Fft::sizeFor(longest), job.plan);
+    }
+
+    for (job.firstRow = 0; job.firstRow < count;
+         job.firstRow += PEARSON_ROWS) {
+        job.lastRow = count - job.firstRow < PEARSON_ROWS
+                          ? count
+                          : job.firstRow + PEARSON_ROWS;
+        if (job.fft) {
+            WorkerPool::run(job.lastRow - job.firstRow, transformRow, &job);
+        }
+
+        WorkerPool::run(count, scanColumn, &job);
 
-        auto now = std::chrono::system_clock::now();
-        auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                             now.time_since_epoch())
-                             .count();
-        int delay = timestamp - currentTimestamp;
-
-        if (!pearsonValues.empty()) {
-            size_t maximumIndex = findMaximumIndex(pearsonValues);
-            writePearsonToFile(symbol1, symbol2arr[maximumIndex],
-                               pearsonValues[maximumIndex], currentTimestamp,
-                               slidingTimestamps[maximumIndex], delay);
+        for (size_t s1 = job.firstRow; job.fft && s1 < job.lastRow; s1++) {
+            job.windows[s1].spectrum = fft_spectrum_t();
         }
     }
 
+    // Each row's best, the first of the highest in column order whichever
+    // thread finished first
+    long timestamp = Clock::nowMs();
+    int delay = timestamp - currentTimestamp;
+    for (size_t s1 = 0; s1 < count; s1++) {
+        size_t best = count;
+        for (size_t s2 = 0; s2 < count; s2++) {
+            double maximum = job.maxima[s1 * count + s2];
+            if (!std::isnan(maximum) &&
+                (best == count || maximum > job.maxima[s1 * count + best])) {
+                best = s2;
+            }
+        }
+        if (best < count) {
+            writePearsonToFile(SYMBOLS[s1], SYMBOLS[best],
+                               job.maxima[s1 * count + best], currentTimestamp,
+                               job.starts[s1 * count + best], delay);
+        }
+    }
+
+    pthread_mutex_lock(&matricesMutex);
+    matrices.push_front(std::move(job.matrix));
+    if (matrices.size() > MATRIX_HISTORY) {
+        matrices.pop_back();
+    }
+    pthread_mutex_unlock(&matricesMutex);
+
     return nullptr;
 }
 
+bool Pearson::getMatrix(size_t age, pearson_matrix_t& out) {
+    pthread_mutex_lock(&matricesMutex);
+    bool found = age < matrices.size();
+    if (found) {
+        out = matrices[age];
+    }
+    pthread_mutex_unlock(&matricesMutex);
+    return found;
+}
+
+std::vector<long> Pearson::matrixTimestamps() {
+    std::vector<long> timestamps;
+    pthread_mutex_lock(&matricesMutex);
+    for (const pearson_matrix_t& matrix : matrices) {
+        timestamps.push_back(matrix.timestamp);
+    }
+    pthread_mutex_unlock(&matricesMutex);
+    return timestamps;
+}
+
 void* Pearson::workerThread(void* arg) {
     scheduler_t* scheduler = (scheduler_t*)arg;
-    std::vector<std::string> symbols = scheduler->SYMBOLS;
 
     while (scheduler->running) {
         // Wait for work signal
@@ -175,12 +538,17 @@ void* Pearson::workerThread(void* arg) {
         }
 
         scheduler->pearsonWorkReady = false;
-        long timestamp = scheduler->currentTimestamp;
+        long timestamp = scheduler->pearsonTimestamp;
         pthread_mutex_unlock(&scheduler->pearsonMutex);
 
-        calculatePearsonArgs args = {symbols, timestamp};
-        calculateAllPearson(&args);
+        runTick(Universe::activeSymbols(), timestamp);
     }
 
     return nullptr;
 }
+
+void Pearson::runTick(const std::vector<int>& symbols,
+                      long timestamp) {
+    calculatePearsonArgs args = {symbols, timestamp};
+    calculateAllPearson(&args);
+}
@@ -1,23 +1,96 @@
 #pragma once
 
 #include <pthread.h>
+#include <stdint.h>
 
 #include <string>
 #include <vector>
 
+#include "fft.hpp"
+
 struct calculatePearsonArgs {
-    std::vector<std::string> SYMBOLS;
+    std::vector<int> SYMBOLS;
     long timestampInMs;
 };
 
+// A window correlated against many others, normalized once
+typedef struct {
+    std::vector<double> values;  // Minus their mean, over their length
+    double sum;                  // Of values, what rounding left of zero
+    fft_spectrum_t spectrum;     // Of values, for scanLagsFft
+} pearson_window_t;
+
+// How every window of a series is normalized, computed once and shared by
+// all the windows correlated against it
+typedef struct {
+    size_t window;
+    std::vector<double> offsets;  // Window mean minus the first point of its
+                                  // block of lags
+    std::vector<double> scales;   // 1 / root of the squared deviations, 0
+                                  // where the series is flat
+    // For scanLagsFft: the series' mean, the spectrum of the series minus
+    // it and a bound on the rounding of the dot products taken through it
+    double level;
+    fft_spectrum_t spectrum;
+    double fftError;
+} pearson_lags_t;
+
+// Every symbol's latest window against every stretch of every symbol's
+// history, one tick
+typedef struct {
+    long timestamp;
+    long stepMs;   // Between two points, lags are in steps
+    int window;    // Points
+    std::vector<int> symbols;  // Rows and columns
+    // Row-major. Best correlation of the row's latest window with any window
+    // of the column, NAN where either has too few points.
+    std::vector<float> correlations;
+    // Steps the best window of the column starts before the row's, -1
+    // where there is no correlation
+    std::vector<int16_t> lags;
+} pearson_matrix_t;
+
 namespace Pearson {
 
-void writePearsonToFile(std::string symbol1, std::string symbol2,
-                        double pearson, long timestamp, long maxTimestamp,
-                        int delay);
+extern const size_t MATRIX_HISTORY;  // Matrices kept, the latest included
+
+// Length of the windows correlated, whole minutes up to a day. False and
+// unchanged otherwise.
+bool setWindow(long ms);
+long windowMs();
+
+void writePearsonToFile(int symbol1, int symbol2, double pearson,
+                        long timestamp, long maxTimestamp, int delay);
 void* calculateAllPearson(void* arg);
 void* workerThread(void* arg);
+void runTick(const std::vector<int>& symbols, long timestamp);
 double calculatePearson(const std::vector<double>& x,
                         const std::vector<double>& y);
 
+// Both reuse the storage of out, so a run allocates once
+void normalizeWindow(const double* x, size_t window, pearson_window_t& out);
+void normalizeLags(const double* y, size_t n, size_t window,
+                   pearson_lags_t& out);
+// Correlation of x against the first count windows of y, oldest first.
+// Allocates nothing.
+void scanLags(const pearson_window_t& x, const double* y,
+              const pearson_lags_t& lags, size_t count, double* out);
+
+// The same for long windows, all lags at once in O(n log n) through the FFT
+// of plan's size, which has to cover y. out holds that many points.
+void transformWindow(const fft_plan_t& plan, pearson_window_t& x);
+void transformLags(const fft_plan_t& plan, const double* y, size_t n,
+                   pearson_lags_t& lags);
+void scanLagsFft(const pearson_window_t& x, const double* y,
+                 const pearson_lags_t& lags, size_t count,
+                 const fft_plan_t& plan, fft_spectrum_t& product,
+                 double* out);
+// Whether scanning n points with a window is faster through the FFT
+bool prefersFft(size_t n, size_t window);
+
+// The matrix age ticks before the latest, false if there is none
+bool getMatrix(size_t age, pearson_matrix_t& out);
+// Of the matrices kept, newest first
+std::vector<long> matrixTimestamps();
+
 }  // namespace Pearson
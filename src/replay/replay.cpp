@@ -0,0 +1,136 @@
+#include "replay.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <queue>
+
+#include "../data_collector/data_collector.hpp"
+#include "../indicators/indicator_engine.hpp"
+#include "../measurement/measurement.hpp"
+#include "../pearson/pearson.hpp"
+#include "../scheduler/scheduler.hpp"
+#include "../tick_log/tick_log.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/symbol_registry.hpp"
+
+typedef struct {
+    long receivedAt;  // Exchange timestamp plus recorded delay
+    size_t log;
+    size_t position;
+} replay_cursor_t;
+
+struct laterFirst {
+    bool operator()(const replay_cursor_t& a, const replay_cursor_t& b) const {
+        if (a.receivedAt != b.receivedAt) {
+            return a.receivedAt > b.receivedAt;
+        }
+        return a.log > b.log;
+    }
+};
+
+static long receivedAt(const tick_record_t& record) {
+    return record.ts + record.delay;
+}
+
+// Runs the bar tick synchronously, indicators first so Pearson always sees
+// this minute's averages
+static void runBar(const std::vector<int>& symbols, long timestamp) {
+    const bool minute = Scheduler::isMinuteTick(timestamp);
+
+    Clock::setVirtualTime(timestamp);
+    if (minute) {
+        Scheduler::cleanup(timestamp);
+    }
+    DataCollector::runTick(symbols, timestamp);
+    if (minute) {
+        Pearson::runTick(symbols, timestamp);
+    }
+}
+
+bool Replay::run(const std::string& directory, const std::vector<int>& symbols,
+                 replay_stats_t& stats) {
+    stats.ticks = 0;
+    stats.bars = 0;
+    stats.seconds = 0;
+
+    std::vector<tick_log_reader_t> readers;
+    std::vector<int> logSymbols;
+    std::priority_queue<replay_cursor_t, std::vector<replay_cursor_t>,
+                        laterFirst>
+        cursors;
+
+    for (int symbol : symbols) {
+        tick_log_reader_t reader;
+        if (!TickLog::openReader(
+                reader,
+                TickLog::logPath(directory, SymbolRegistry::name(symbol)))) {
+            continue;
+        }
+        if (reader.count == 0) {
+            TickLog::closeReader(reader);
+            continue;
+        }
+
+        readers.push_back(reader);
+        logSymbols.push_back(symbol);
+        replay_cursor_t cursor = {receivedAt(reader.records[0]),
+                                  readers.size() - 1, 0};
+        cursors.push(cursor);
+    }
+
+    if (readers.empty()) {
+        std::cerr << "No tick logs found in " << directory << std::endl;
+        return false;
+    }
+
+    // The recorded ticks are stored again in memory, not on disk
+    bool tickLogEnabled = Measurement::tickLogEnabled;
+    Measurement::tickLogEnabled = false;
+
+    auto start = std::chrono::steady_clock::now();
+    const long barMs = IndicatorEngine::barMs();
+    long nextBar = (cursors.top().receivedAt / barMs + 1) * barMs;
+
+    // Merge all symbols in the order the ticks originally arrived
+    while (!cursors.empty()) {
+        replay_cursor_t cursor = cursors.top();
+        cursors.pop();
+
+        while (cursor.receivedAt >= nextBar) {
+            runBar(symbols, nextBar);
+            stats.bars++;
+            nextBar += barMs;
+        }
+
+        const tick_record_t& record =
+            readers[cursor.log].records[cursor.position];
+        Clock::setVirtualTime(cursor.receivedAt);
+        Measurement::storeMeasurement(
+            logSymbols[cursor.log],
+            Measurement::create(record.px, record.sz, record.ts));
+        stats.ticks++;
+
+        if (++cursor.position < readers[cursor.log].count) {
+            cursor.receivedAt =
+                receivedAt(readers[cursor.log].records[cursor.position]);
+            cursors.push(cursor);
+        }
+    }
+
+    // Close the bar the last tick fell into
+    runBar(symbols, nextBar);
+    stats.bars++;
+
+    stats.seconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+
+    Measurement::tickLogEnabled = tickLogEnabled;
+    Clock::useSystemTime();
+
+    for (tick_log_reader_t& reader : readers) {
+        TickLog::closeReader(reader);
+    }
+
+    return true;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+typedef struct {
+    long ticks;
+    long bars;
+    double seconds;  // Wall-clock time spent replaying
+} replay_stats_t;
+
+namespace Replay {
+
+// Feeds the tick logs found in directory through the ingest and indicator
+// pipeline on a virtual clock, as fast as possible. Outputs land in the
+// usual data/ files. symbols are SymbolRegistry ids. Returns false if no
+// log could be opened.
+bool run(const std::string& directory, const std::vector<int>& symbols,
+         replay_stats_t& stats);
+
+}  // namespace Replay
@@ -9,11 +9,25 @@
 #include <iostream>
 
 #include "../data_collector/data_collector.hpp"
+#include "../indicators/indicator_engine.hpp"
 #include "../measurement/measurement.hpp"
 #include "../pearson/pearson.hpp"
+#include "../utils/clock.hpp"
 #include "../utils/cpu_stats.hpp"
 
+const long Scheduler::MINUTE_MS = 60 * 1000;
+const long Scheduler::DEFAULT_GRACE_MS = 500;
+
 static scheduler_t* active_scheduler = nullptr;
+static long graceMs = Scheduler::DEFAULT_GRACE_MS;
+
+bool Scheduler::setGraceMs(long ms) {
+    if (ms < 0 || ms >= IndicatorEngine::barMs()) {
+        return false;
+    }
+    graceMs = ms;
+    return true;
+}
 
 void* schedulerThreadFunction(void* args) {
     scheduler_t* scheduler = (scheduler_t*)args;
@@ -21,9 +35,8 @@ void* schedulerThreadFunction(void* args) {
     return nullptr;
 }
 
-scheduler_t* Scheduler::create(std::vector<std::string> SYMBOLS) {
+scheduler_t* Scheduler::create() {
     scheduler_t* scheduler = new scheduler_t();
-    scheduler->SYMBOLS = SYMBOLS;
     scheduler->running = false;
 
     pthread_cond_init(&scheduler->averageCondition, nullptr);
@@ -81,43 +94,67 @@ void Scheduler::stop(scheduler_t& scheduler) {
 }
 
 void Scheduler::run(scheduler_t& scheduler) {
-    while (scheduler.running) {
-        auto now = std::chrono::system_clock::now();
-        auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                             now.time_since_epoch())
-                             .count();
-        long nextMinuteTimestampInMs = ((timestamp / 60000) + 1) * 60000;
-        long msToWait = nextMinuteTimestampInMs - timestamp;
+    const long barMs = IndicatorEngine::barMs();
 
-        std::cout << "Sleeping for " << msToWait / 1000 << " seconds"
-                  << std::endl;
+    while (scheduler.running) {
+        long timestamp = Clock::nowMs();
+        long nextBarTimestampInMs = ((timestamp / barMs) + 1) * barMs;
+        long tickAt = nextBarTimestampInMs + graceMs;
+        long msToWait = tickAt - timestamp;
+
+        if (msToWait >= 1000) {
+            std::cout << "Sleeping for " << msToWait / 1000 << " seconds"
+                      << std::endl;
+        }
 
-        usleep(msToWait * 1000);
+        // Sleep in short steps so stop() does not wait a whole bar
+        while (scheduler.running && msToWait > 0) {
+            usleep((msToWait < 100 ? msToWait : 100) * 1000);
+            msToWait = tickAt - Clock::nowMs();
+        }
 
         if (!scheduler.running) {
             return;
         }
 
-        scheduler.currentTimestamp = nextMinuteTimestampInMs;
+        tick(scheduler, nextBarTimestampInMs);
+    }
+}
+
+void Scheduler::cleanup(long timestamp) {
+    Measurement::cleanupOldMeasurements(timestamp);
+    DataCollector::cleanupOldAverages(timestamp);
+    DataCollector::cleanupOldData(timestamp);
+}
+
+bool Scheduler::isMinuteTick(long timestamp) {
+    return timestamp % MINUTE_MS == 0;
+}
+
+void Scheduler::tick(scheduler_t& scheduler, long timestamp) {
+    const bool minute = isMinuteTick(timestamp);
 
-        Measurement::cleanupOldMeasurements(scheduler.currentTimestamp);
-        DataCollector::cleanupOldAverages(scheduler.currentTimestamp);
-        DataCollector::cleanupOldData(scheduler.currentTimestamp);
+    if (minute) {
+        cleanup(timestamp);
 
         // Calculate and write CPU stats
         double cpuIdlePercentage = CpuStats::getCpuIdlePercentage();
         if (cpuIdlePercentage >= 0.0) {
-            CpuStats::writeCpuStats(scheduler.currentTimestamp,
-                                    cpuIdlePercentage);
+            CpuStats::writeCpuStats(timestamp, cpuIdlePercentage);
         }
+    }
 
-        // Signal worker threads to start working
-        pthread_mutex_lock(&scheduler.averageMutex);
-        scheduler.averageWorkReady = true;
-        pthread_cond_signal(&scheduler.averageCondition);
-        pthread_mutex_unlock(&scheduler.averageMutex);
+    // Signal worker threads to start working. A worker still busy with the
+    // previous tick picks up the newest timestamp once it is done.
+    pthread_mutex_lock(&scheduler.averageMutex);
+    scheduler.currentTimestamp = timestamp;
+    scheduler.averageWorkReady = true;
+    pthread_cond_signal(&scheduler.averageCondition);
+    pthread_mutex_unlock(&scheduler.averageMutex);
 
+    if (minute) {
         pthread_mutex_lock(&scheduler.pearsonMutex);
+        scheduler.pearsonTimestamp = timestamp;
         scheduler.pearsonWorkReady = true;
         pthread_cond_signal(&scheduler.pearsonCondition);
         pthread_mutex_unlock(&scheduler.pearsonMutex);
@@ -3,15 +3,12 @@
 #include <pthread.h>
 
 #include <atomic>
-#include <string>
-#include <vector>
 
 typedef struct {
     pthread_t threadScheduler;
     pthread_t threadAverage;
     pthread_t threadPearson;
     std::atomic<bool> running;
-    std::vector<std::string> SYMBOLS;
 
     // Synchronization primitives
     pthread_cond_t averageCondition;
@@ -20,15 +17,31 @@ typedef struct {
     pthread_mutex_t pearsonMutex;
     bool averageWorkReady;
     bool pearsonWorkReady;
-    long currentTimestamp;
+    long currentTimestamp;  // Guarded by averageMutex
+    long pearsonTimestamp;  // Guarded by pearsonMutex
 } scheduler_t;
 
 namespace Scheduler {
 
-scheduler_t* create(std::vector<std::string> SYMBOLS);
+extern const long MINUTE_MS;
+extern const long DEFAULT_GRACE_MS;
+
+// How long after a bar's end its tick runs, so trades of the bar still on
+// the wire are folded in before it is sealed. The tick keeps the bar's end
+// as its timestamp. Under one bar, false and unchanged otherwise.
+bool setGraceMs(long ms);
+
+// The indicators tick once per bar. Cleanup, CPU stats and Pearson keep their
+// one-minute cadence and run on the ticks that fall on a minute boundary.
+bool isMinuteTick(long timestamp);
+
+// Workers compute the symbols active in the Universe at each tick
+scheduler_t* create();
 void destroy(scheduler_t& scheduler);
 void start(scheduler_t& scheduler);
 void run(scheduler_t& scheduler);
+void tick(scheduler_t& scheduler, long timestamp);
+void cleanup(long timestamp);
 void stop(scheduler_t& scheduler);
 
 }  // namespace Scheduler
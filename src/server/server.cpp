@@ -1,9 +1,20 @@
 #include "server.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
 #include <sstream>
 
+#include "../bars/bars.hpp"
+#include "../ingest/ingest.hpp"
+#include "../metrics/latency.hpp"
+#include "../pearson/pearson.hpp"
+#include "../universe/universe.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/symbol_registry.hpp"
+
 HTTPServer::HTTPServer(int port) : port_(port), running_(false) {}
 
 HTTPServer::~HTTPServer() { stop(); }
@@ -42,107 +53,165 @@ void HTTPServer::setupRoutes() {
     });
 
     // Simple Moving Average endpoint
-    server_.Get("/sma",
-                [this](const httplib::Request& req, httplib::Response& res) {
-                    handleSMA(req, res);
-                });
+    addRoute("/sma", &HTTPServer::handleSMA);
 
     // Exponential Moving Average endpoint
-    server_.Get("/ema",
-                [this](const httplib::Request& req, httplib::Response& res) {
-                    handleEMA(req, res);
-                });
+    addRoute("/ema", &HTTPServer::handleEMA);
 
     // MACD endpoint
-    server_.Get("/macd",
-                [this](const httplib::Request& req, httplib::Response& res) {
-                    handleMACD(req, res);
-                });
+    addRoute("/macd", &HTTPServer::handleMACD);
 
     // Signal endpoint
-    server_.Get("/signal",
-                [this](const httplib::Request& req, httplib::Response& res) {
-                    handleSignal(req, res);
-                });
+    addRoute("/signal", &HTTPServer::handleSignal);
 
     // Distance endpoint
-    server_.Get("/distance",
-                [this](const httplib::Request& req, httplib::Response& res) {
-                    handleDistance(req, res);
-                });
+    addRoute("/distance", &HTTPServer::handleDistance);
 
     // Closing price endpoint
-    server_.Get("/close",
-                [this](const httplib::Request& req, httplib::Response& res) {
-                    handleClosingPrice(req, res);
-                });
+    addRoute("/close", &HTTPServer::handleClosingPrice);
+
+    // Any indicator by name, and the registry with what is computed
+    addRoute("/indicator", &HTTPServer::handleIndicator);
+    addRoute("/indicators", &HTTPServer::handleIndicators);
+
+    // Sealed OHLCV bars, resolution is one of 1s, 1m, 5m, 1h
+    addRoute("/bars", &HTTPServer::handleBars);
+
+    // Correlation matrix of the latest Pearson run, or an earlier one
+    addRoute("/pearson", &HTTPServer::handlePearson);
+
+    // Tick queue counters of the ingest stage
+    addRoute("/metrics/ingest", &HTTPServer::handleIngestMetrics);
+
+    // Per-stage latency percentiles
+    addRoute("/metrics/latency", &HTTPServer::handleLatencyMetrics);
+
+    // Runtime changes to the instrument universe
+    addPostRoute("/admin/subscribe", &HTTPServer::handleSubscribe);
+    addPostRoute("/admin/unsubscribe", &HTTPServer::handleUnsubscribe);
+    addRoute("/admin/symbols", &HTTPServer::handleSymbols);
+
+    // Which indicators are computed
+    addPostRoute("/admin/indicators/subscribe",
+                 &HTTPServer::handleIndicatorSubscribe);
+    addPostRoute("/admin/indicators/unsubscribe",
+                 &HTTPServer::handleIndicatorUnsubscribe);
+}
+
+void HTTPServer::addRoute(const char* path, route_handler_t handler) {
+    server_.Get(path, timed(handler));
+}
+
+void HTTPServer::addPostRoute(const char* path, route_handler_t handler) {
+    server_.Post(path, timed(handler));
+}
+
+httplib::Server::Handler HTTPServer::timed(route_handler_t handler) {
+    return [this, handler](const httplib::Request& req,
+                           httplib::Response& res) {
+        long start = Latency::nowNs();
+        (this->*handler)(req, res);
+
+        int symbol = req.has_param("symbol")
+                         ? SymbolRegistry::lookup(req.get_param_value("symbol"))
+                         : -1;
+        Latency::record(STAGE_HTTP_REQUEST, symbol,
+                        (Latency::nowNs() - start) / 1000);
+    };
 }
 
 void HTTPServer::run() { server_.listen("0.0.0.0", port_); }
 
 void HTTPServer::handleSMA(const httplib::Request& req,
                            httplib::Response& res) {
-    if (!validateParameters(req, {"symbol", "window"})) {
+    answerIndicator(req, res, INDICATOR_SMA);
+}
+
+void HTTPServer::handleEMA(const httplib::Request& req,
+                           httplib::Response& res) {
+    if (!validateParameters(req, {"type"})) {
         res.status = 400;
-        res.set_content(
-            createErrorResponse("Missing symbol or window parameter"),
-            "application/json");
+        res.set_content(createErrorResponse("Missing type parameter"),
+                        "application/json");
         return;
     }
 
-    try {
-        std::string symbol = req.get_param_value("symbol");
-        int window = std::stoi(req.get_param_value("window"));
-        long timestamp = getCurrentTimestamp();
+    std::string type = req.get_param_value("type");
+    if (type == "short") {
+        answerIndicator(req, res, INDICATOR_EMA_SHORT);
+    } else if (type == "long") {
+        answerIndicator(req, res, INDICATOR_EMA_LONG);
+    } else {
+        res.status = 400;
+        res.set_content(createErrorResponse("Invalid type parameter"),
+                        "application/json");
+    }
+}
 
-        value_t averages =
-            DataCollector::getRecentAverages(symbol, timestamp, window);
+void HTTPServer::handleMACD(const httplib::Request& req,
+                            httplib::Response& res) {
+    answerIndicator(req, res, INDICATOR_MACD);
+}
 
-        if (averages.values.empty()) {
-            res.status = 404;
-            res.set_content(createErrorResponse("No data found for symbol"),
-                            "application/json");
-            return;
-        }
+void HTTPServer::handleSignal(const httplib::Request& req,
+                              httplib::Response& res) {
+    answerIndicator(req, res, INDICATOR_SIGNAL);
+}
 
-        value_t filteredAverages = filterDataPoints(averages);
-        std::string json = valueToJson(filteredAverages);
-        res.set_content(json, "application/json");
-    } catch (const std::exception& e) {
-        res.status = 400;
-        res.set_content(createErrorResponse("Invalid window parameter"),
-                        "application/json");
+void HTTPServer::handleDistance(const httplib::Request& req,
+                                httplib::Response& res) {
+    answerIndicator(req, res, INDICATOR_DISTANCE);
+}
+
+void HTTPServer::handleClosingPrice(const httplib::Request& req,
+                                    httplib::Response& res) {
+    answerIndicator(req, res, INDICATOR_CLOSE);
+}
+
+void HTTPServer::handleIndicator(const httplib::Request& req,
+                                 httplib::Response& res) {
+    int indicator = lookupIndicator(req, res);
+    if (indicator >= 0) {
+        answerIndicator(req, res, (indicator_t)indicator);
     }
 }
 
-void HTTPServer::handleEMA(const httplib::Request& req,
-                           httplib::Response& res) {
-    if (!validateParameters(req, {"symbol", "window", "type"})) {
+void HTTPServer::answerIndicator(const httplib::Request& req,
+                                 httplib::Response& res,
+                                 indicator_t indicator) {
+    if (!validateParameters(req, {"symbol", "window"})) {
         res.status = 400;
         res.set_content(
-            createErrorResponse("Missing symbol, window, or type parameter"),
+            createErrorResponse("Missing symbol or window parameter"),
             "application/json");
         return;
     }
 
+    if (!DataCollector::isComputed(indicator)) {
+        res.status = 404;
+        res.set_content(createErrorResponse("Indicator not subscribed"),
+                        "application/json");
+        return;
+    }
+
     try {
-        std::string symbol = req.get_param_value("symbol");
+        int symbol = lookupSymbol(req, res);
+        if (symbol < 0) {
+            return;
+        }
         int window = std::stoi(req.get_param_value("window"));
-        std::string type = req.get_param_value("type");
-        long timestamp = getCurrentTimestamp();
 
-        value_t emas =
-            DataCollector::getRecentEMA(symbol, timestamp, window, type);
+        value_t values = DataCollector::getRecent(indicator, symbol, window);
 
-        if (emas.values.empty()) {
+        if (values.values.empty()) {
             res.status = 404;
             res.set_content(createErrorResponse("No data found for symbol"),
                             "application/json");
             return;
         }
 
-        value_t filteredEmas = filterDataPoints(emas);
-        std::string json = valueToJson(filteredEmas);
+        value_t filteredValues = filterDataPoints(values);
+        std::string json = valueToJson(filteredValues);
         res.set_content(json, "application/json");
     } catch (const std::exception& e) {
         res.status = 400;
@@ -151,143 +220,358 @@ void HTTPServer::handleEMA(const httplib::Request& req,
     }
 }
 
-void HTTPServer::handleMACD(const httplib::Request& req,
+void HTTPServer::handleIndicators(const httplib::Request& req,
+                                  httplib::Response& res) {
+    std::ostringstream json;
+    json << "{\"indicators\": [";
+    for (int i = 0; i < INDICATOR_COUNT; i++) {
+        indicator_t indicator = (indicator_t)i;
+        std::vector<indicator_t> inputs = IndicatorEngine::inputs(indicator);
+
+        json << "{\"name\": \"" << IndicatorEngine::name(indicator)
+             << "\", \"inputs\": [";
+        for (size_t j = 0; j < inputs.size(); j++) {
+            json << "\"" << IndicatorEngine::name(inputs[j]) << "\"";
+            if (j < inputs.size() - 1) {
+                json << ", ";
+            }
+        }
+        json << "], \"subscribed\": "
+             << (DataCollector::isSubscribed(indicator) ? "true" : "false")
+             << ", \"computed\": "
+             << (DataCollector::isComputed(indicator) ? "true" : "false")
+             << "}";
+        if (i < INDICATOR_COUNT - 1) {
+            json << ", ";
+        }
+    }
+    json << "]}";
+
+    res.set_content(json.str(), "application/json");
+}
+
+void HTTPServer::handleIndicatorSubscribe(const httplib::Request& req,
+                                          httplib::Response& res) {
+    answerIndicatorChange(req, res, true);
+}
+
+void HTTPServer::handleIndicatorUnsubscribe(const httplib::Request& req,
+                                            httplib::Response& res) {
+    answerIndicatorChange(req, res, false);
+}
+
+void HTTPServer::answerIndicatorChange(const httplib::Request& req,
+                                       httplib::Response& res,
+                                       bool subscribe) {
+    if (!checkAdmin(req, res)) {
+        return;
+    }
+
+    int indicator = lookupIndicator(req, res);
+    if (indicator < 0) {
+        return;
+    }
+
+    indicator_t id = (indicator_t)indicator;
+    bool changed = subscribe ? DataCollector::subscribe(id)
+                             : DataCollector::unsubscribe(id);
+
+    std::ostringstream json;
+    json << "{\"indicator\": \"" << IndicatorEngine::name(id)
+         << "\", \"subscribed\": " << (subscribe ? "true" : "false")
+         << ", \"changed\": " << (changed ? "true" : "false") << "}";
+    res.set_content(json.str(), "application/json");
+}
+
+void HTTPServer::handleBars(const httplib::Request& req,
                             httplib::Response& res) {
-    if (!validateParameters(req, {"symbol", "window"})) {
+    if (!validateParameters(req, {"symbol", "resolution"})) {
         res.status = 400;
         res.set_content(
-            createErrorResponse("Missing symbol or window parameter"),
+            createErrorResponse("Missing symbol or resolution parameter"),
             "application/json");
         return;
     }
 
+    int resolution = Bars::parseResolution(req.get_param_value("resolution"));
+    if (resolution < 0) {
+        res.status = 400;
+        res.set_content(createErrorResponse("Invalid resolution parameter"),
+                        "application/json");
+        return;
+    }
+
     try {
-        std::string symbol = req.get_param_value("symbol");
-        int window = std::stoi(req.get_param_value("window"));
-        long timestamp = getCurrentTimestamp();
+        int symbol = lookupSymbol(req, res);
+        if (symbol < 0) {
+            return;
+        }
+        size_t count = Bars::HISTORY_LENGTH;
+        if (req.has_param("count")) {
+            count = std::stoul(req.get_param_value("count"));
+        }
 
-        value_t macd = DataCollector::getRecentMACD(symbol, timestamp, window);
+        std::vector<bar_t> bars = Bars::getRecentBars(
+            symbol, (bar_resolution_t)resolution, Clock::nowMs(), count);
 
-        if (macd.values.empty()) {
+        if (bars.empty()) {
             res.status = 404;
             res.set_content(createErrorResponse("No data found for symbol"),
                             "application/json");
             return;
         }
 
-        value_t filteredMacd = filterDataPoints(macd);
-        std::string json = valueToJson(filteredMacd);
-        res.set_content(json, "application/json");
+        std::ostringstream json;
+        json << "{\"resolution\": \"" << Bars::RESOLUTION_NAMES[resolution]
+             << "\", \"bars\": [";
+        for (size_t i = 0; i < bars.size(); ++i) {
+            const bar_t& bar = bars[i];
+            json << "{\"start\": " << bar.start << ", \"open\": " << bar.open
+                 << ", \"high\": " << bar.high << ", \"low\": " << bar.low
+                 << ", \"close\": " << bar.close
+                 << ", \"volume\": " << bar.volume
+                 << ", \"vwap\": " << Bars::vwap(bar)
+                 << ", \"trades\": " << bar.trades << "}";
+            if (i < bars.size() - 1) {
+                json << ", ";
+            }
+        }
+        json << "]}";
+
+        res.set_content(json.str(), "application/json");
     } catch (const std::exception& e) {
         res.status = 400;
-        res.set_content(createErrorResponse("Invalid window parameter"),
+        res.set_content(createErrorResponse("Invalid count parameter"),
                         "application/json");
     }
 }
 
-void HTTPServer::handleSignal(const httplib::Request& req,
-                              httplib::Response& res) {
-    if (!validateParameters(req, {"symbol", "window"})) {
-        res.status = 400;
-        res.set_content(
-            createErrorResponse("Missing symbol or window parameter"),
-            "application/json");
-        return;
+// Matrix rows [first, end) as JSON arrays, null where there is no
+// correlation
+static void appendRows(std::string& json, const pearson_matrix_t& matrix,
+                       size_t first, size_t end, bool lags) {
+    const size_t count = matrix.symbols.size();
+    for (size_t row = first; row < end; row++) {
+        json += row > first ? ", [" : "[";
+        for (size_t column = 0; column < count; column++) {
+            size_t cell = row * count + column;
+            char value[16];
+            if (std::isnan(matrix.correlations[cell])) {
+                snprintf(value, sizeof value, "null");
+            } else if (lags) {
+                snprintf(value, sizeof value, "%d", matrix.lags[cell]);
+            } else {
+                snprintf(value, sizeof value, "%.4f",
+                         matrix.correlations[cell]);
+            }
+            json += column > 0 ? "," : "";
+            json += value;
+        }
+        json += "]";
     }
+}
 
+void HTTPServer::handlePearson(const httplib::Request& req,
+                               httplib::Response& res) {
+    size_t age = 0;
     try {
-        std::string symbol = req.get_param_value("symbol");
-        int window = std::stoi(req.get_param_value("window"));
-        long timestamp = getCurrentTimestamp();
+        if (req.has_param("age")) {
+            age = std::stoul(req.get_param_value("age"));
+        }
+    } catch (const std::exception& e) {
+        res.status = 400;
+        res.set_content(createErrorResponse("Invalid age parameter"),
+                        "application/json");
+        return;
+    }
 
-        value_t signals =
-            DataCollector::getRecentSignal(symbol, timestamp, window);
+    pearson_matrix_t matrix;
+    if (!Pearson::getMatrix(age, matrix)) {
+        res.status = 404;
+        res.set_content(createErrorResponse("No correlation matrix yet"),
+                        "application/json");
+        return;
+    }
 
-        if (signals.values.empty()) {
+    // All rows, or only the symbol's
+    size_t firstRow = 0, endRow = matrix.symbols.size();
+    if (req.has_param("symbol")) {
+        int symbol = lookupSymbol(req, res);
+        if (symbol < 0) {
+            return;
+        }
+        std::vector<int>::iterator it = std::find(
+            matrix.symbols.begin(), matrix.symbols.end(), symbol);
+        if (it == matrix.symbols.end()) {
             res.status = 404;
             res.set_content(createErrorResponse("No data found for symbol"),
                             "application/json");
             return;
         }
+        firstRow = it - matrix.symbols.begin();
+        endRow = firstRow + 1;
+    }
 
-        value_t filteredSignals = filterDataPoints(signals);
-        std::string json = valueToJson(filteredSignals);
-        res.set_content(json, "application/json");
-    } catch (const std::exception& e) {
-        res.status = 400;
-        res.set_content(createErrorResponse("Invalid window parameter"),
-                        "application/json");
+    std::ostringstream header;
+    header << "{\"timestamp\": " << matrix.timestamp
+           << ", \"stepMs\": " << matrix.stepMs
+           << ", \"window\": " << matrix.window << ", \"history\": [";
+    std::vector<long> history = Pearson::matrixTimestamps();
+    for (size_t i = 0; i < history.size(); i++) {
+        header << (i > 0 ? ", " : "") << history[i];
+    }
+    header << "], \"symbols\": [";
+    for (size_t i = 0; i < matrix.symbols.size(); i++) {
+        header << (i > 0 ? ", " : "") << "\""
+               << SymbolRegistry::name(matrix.symbols[i]) << "\"";
     }
+    header << "], \"rows\": [";
+    for (size_t row = firstRow; row < endRow; row++) {
+        header << (row > firstRow ? ", " : "") << "\""
+               << SymbolRegistry::name(matrix.symbols[row]) << "\"";
+    }
+    header << "]";
+
+    // Rows of numbers, built without a stream, 500 symbols are 250000 cells
+    std::string json = header.str();
+    json.reserve(json.size() + (endRow - firstRow) *
+                                   matrix.symbols.size() * 12);
+    json += ", \"correlations\": [";
+    appendRows(json, matrix, firstRow, endRow, false);
+    json += "], \"lags\": [";
+    appendRows(json, matrix, firstRow, endRow, true);
+    json += "]}";
+
+    res.set_content(json, "application/json");
 }
 
-void HTTPServer::handleDistance(const httplib::Request& req,
-                                httplib::Response& res) {
-    if (!validateParameters(req, {"symbol", "window"})) {
-        res.status = 400;
-        res.set_content(
-            createErrorResponse("Missing symbol or window parameter"),
-            "application/json");
-        return;
+void HTTPServer::handleIngestMetrics(const httplib::Request& req,
+                                     httplib::Response& res) {
+    std::vector<ingest_stats_t> stats = Ingest::getStats();
+
+    std::ostringstream json;
+    json << "{\"connections\": [";
+    for (size_t i = 0; i < stats.size(); ++i) {
+        json << "{\"connection\": " << stats[i].connection
+             << ", \"capacity\": " << stats[i].capacity
+             << ", \"depth\": " << stats[i].depth
+             << ", \"highWaterMark\": " << stats[i].highWaterMark
+             << ", \"drops\": " << stats[i].drops
+             << ", \"oversized\": " << stats[i].oversized << "}";
+        if (i < stats.size() - 1) {
+            json << ", ";
+        }
     }
+    json << "]}";
 
-    try {
-        std::string symbol = req.get_param_value("symbol");
-        int window = std::stoi(req.get_param_value("window"));
-        long timestamp = getCurrentTimestamp();
+    res.set_content(json.str(), "application/json");
+}
 
-        value_t distances =
-            DataCollector::getRecentDistance(symbol, timestamp, window);
+void HTTPServer::handleSubscribe(const httplib::Request& req,
+                                 httplib::Response& res) {
+    answerUniverseChange(req, res, true);
+}
 
-        if (distances.values.empty()) {
-            res.status = 404;
-            res.set_content(createErrorResponse("No data found for symbol"),
-                            "application/json");
-            return;
-        }
+void HTTPServer::handleUnsubscribe(const httplib::Request& req,
+                                   httplib::Response& res) {
+    answerUniverseChange(req, res, false);
+}
 
-        value_t filteredDistances = filterDataPoints(distances);
-        std::string json = valueToJson(filteredDistances);
-        res.set_content(json, "application/json");
-    } catch (const std::exception& e) {
+void HTTPServer::answerUniverseChange(const httplib::Request& req,
+                                      httplib::Response& res,
+                                      bool subscribe) {
+    if (!checkAdmin(req, res)) {
+        return;
+    }
+    if (!validateParameters(req, {"symbol"})) {
         res.status = 400;
-        res.set_content(createErrorResponse("Invalid window parameter"),
+        res.set_content(createErrorResponse("Missing symbol parameter"),
                         "application/json");
+        return;
+    }
+
+    std::string symbol = req.get_param_value("symbol");
+    universe_result_t result = subscribe ? Universe::subscribe(symbol)
+                                         : Universe::unsubscribe(symbol);
+
+    const char* status;
+    switch (result) {
+        case UNIVERSE_OK:
+            status = subscribe ? "subscribed" : "unsubscribed";
+            break;
+        case UNIVERSE_UNCHANGED:
+            status = subscribe ? "already subscribed" : "not subscribed";
+            break;
+        case UNIVERSE_INVALID:
+            res.status = 400;
+            res.set_content(createErrorResponse("Invalid symbol"),
+                            "application/json");
+            return;
+        default:
+            res.status = 503;
+            res.set_content(createErrorResponse("Symbol limit reached"),
+                            "application/json");
+            return;
     }
+
+    std::ostringstream json;
+    json << "{\"symbol\": \"" << symbol << "\", \"status\": \"" << status
+         << "\"}";
+    res.set_content(json.str(), "application/json");
 }
 
-void HTTPServer::handleClosingPrice(const httplib::Request& req,
-                                    httplib::Response& res) {
-    if (!validateParameters(req, {"symbol", "window"})) {
-        res.status = 400;
-        res.set_content(
-            createErrorResponse("Missing symbol or window parameter"),
-            "application/json");
-        return;
+void HTTPServer::handleSymbols(const httplib::Request& req,
+                               httplib::Response& res) {
+    std::vector<int> symbols = Universe::activeSymbols();
+
+    std::ostringstream json;
+    json << "{\"symbols\": [";
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        json << "\"" << SymbolRegistry::name(symbols[i]) << "\"";
+        if (i < symbols.size() - 1) {
+            json << ", ";
+        }
     }
+    json << "]}";
 
-    try {
-        std::string symbol = req.get_param_value("symbol");
-        int window = std::stoi(req.get_param_value("window"));
-        long timestamp = getCurrentTimestamp();
+    res.set_content(json.str(), "application/json");
+}
+
+static void summaryToJson(std::ostringstream& json,
+                          const latency_summary_t& summary) {
+    json << "{\"count\": " << summary.count << ", \"p50\": " << summary.p50
+         << ", \"p99\": " << summary.p99 << ", \"p999\": " << summary.p999
+         << ", \"max\": " << summary.max << "}";
+}
 
-        value_t closingPrices =
-            DataCollector::getRecentClosingPrices(symbol, timestamp, window);
+void HTTPServer::handleLatencyMetrics(const httplib::Request& req,
+                                      httplib::Response& res) {
+    int symbolCount = SymbolRegistry::count();
 
-        if (closingPrices.values.empty()) {
-            res.status = 404;
-            res.set_content(createErrorResponse("No data found for symbol"),
-                            "application/json");
-            return;
+    std::ostringstream json;
+    json << "{\"unit\": \"us\", \"stages\": {";
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+        latency_stage_t s = (latency_stage_t)stage;
+        json << "\"" << Latency::stageName(s) << "\": {\"all\": ";
+        summaryToJson(json, Latency::summarize(s, -1));
+
+        for (int i = 0; i < symbolCount; ++i) {
+            latency_summary_t summary = Latency::summarize(s, i);
+            if (summary.count == 0) {
+                continue;
+            }
+            json << ", \"" << SymbolRegistry::name(i) << "\": ";
+            summaryToJson(json, summary);
         }
 
-        value_t filteredClosingPrices = filterDataPoints(closingPrices);
-        std::string json = valueToJson(filteredClosingPrices);
-        res.set_content(json, "application/json");
-    } catch (const std::exception& e) {
-        res.status = 400;
-        res.set_content(createErrorResponse("Invalid window parameter"),
-                        "application/json");
+        json << "}";
+        if (stage < STAGE_COUNT - 1) {
+            json << ", ";
+        }
     }
+    json << "}}";
+
+    res.set_content(json.str(), "application/json");
 }
 
 std::string HTTPServer::valueToJson(const value_t& data) {
@@ -320,15 +604,6 @@ std::string HTTPServer::createErrorResponse(const std::string& message) {
     return json.str();
 }
 
-long HTTPServer::getCurrentTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(
-                         now.time_since_epoch())
-                         .count();
-    long currentMinuteTimestamp = (timestamp / 60000) * 60000;
-    return currentMinuteTimestamp;
-}
-
 bool HTTPServer::validateParameters(
     const httplib::Request& req,
     const std::vector<std::string>& required_params) {
@@ -340,6 +615,47 @@ bool HTTPServer::validateParameters(
     return true;
 }
 
+int HTTPServer::lookupSymbol(const httplib::Request& req,
+                             httplib::Response& res) {
+    int symbol = SymbolRegistry::lookup(req.get_param_value("symbol"));
+    if (symbol < 0) {
+        res.status = 404;
+        res.set_content(createErrorResponse("Unknown symbol"),
+                        "application/json");
+    }
+    return symbol;
+}
+
+int HTTPServer::lookupIndicator(const httplib::Request& req,
+                                httplib::Response& res) {
+    if (!validateParameters(req, {"name"})) {
+        res.status = 400;
+        res.set_content(createErrorResponse("Missing name parameter"),
+                        "application/json");
+        return -1;
+    }
+
+    int indicator = IndicatorEngine::lookup(req.get_param_value("name"));
+    if (indicator < 0) {
+        res.status = 404;
+        res.set_content(createErrorResponse("Unknown indicator"),
+                        "application/json");
+    }
+    return indicator;
+}
+
+bool HTTPServer::checkAdmin(const httplib::Request& req,
+                            httplib::Response& res) {
+    if (req.remote_addr == "127.0.0.1" || req.remote_addr == "::1") {
+        return true;
+    }
+
+    res.status = 403;
+    res.set_content(createErrorResponse("Admin endpoints are local only"),
+                    "application/json");
+    return false;
+}
+
 value_t HTTPServer::filterDataPoints(const value_t& data, size_t maxPoints) {
     if (data.values.size() <= maxPoints) {
         return data;
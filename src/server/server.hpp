@@ -8,6 +8,11 @@
 
 #include "../data_collector/data_collector.hpp"
 
+class HTTPServer;
+
+typedef void (HTTPServer::*route_handler_t)(const httplib::Request& req,
+                                            httplib::Response& res);
+
 class HTTPServer {
    public:
     HTTPServer(int port = 8080);
@@ -25,6 +30,11 @@ class HTTPServer {
     void setupRoutes();
     void run();
 
+    // Register GET/POST handlers that also record their latency
+    void addRoute(const char* path, route_handler_t handler);
+    void addPostRoute(const char* path, route_handler_t handler);
+    httplib::Server::Handler timed(route_handler_t handler);
+
     // Endpoint handlers
     void handleSMA(const httplib::Request& req, httplib::Response& res);
     void handleEMA(const httplib::Request& req, httplib::Response& res);
@@ -33,12 +43,41 @@ class HTTPServer {
     void handleDistance(const httplib::Request& req, httplib::Response& res);
     void handleClosingPrice(const httplib::Request& req,
                             httplib::Response& res);
+    void handleIndicator(const httplib::Request& req, httplib::Response& res);
+    void handleIndicators(const httplib::Request& req,
+                          httplib::Response& res);
+    void handleBars(const httplib::Request& req, httplib::Response& res);
+    void handlePearson(const httplib::Request& req, httplib::Response& res);
+    void handleIngestMetrics(const httplib::Request& req,
+                             httplib::Response& res);
+    void handleLatencyMetrics(const httplib::Request& req,
+                              httplib::Response& res);
+    void handleSubscribe(const httplib::Request& req, httplib::Response& res);
+    void handleUnsubscribe(const httplib::Request& req,
+                           httplib::Response& res);
+    void handleSymbols(const httplib::Request& req, httplib::Response& res);
+    void handleIndicatorSubscribe(const httplib::Request& req,
+                                  httplib::Response& res);
+    void handleIndicatorUnsubscribe(const httplib::Request& req,
+                                    httplib::Response& res);
 
     // Utility functions
     std::string valueToJson(const value_t& data);
     std::string createErrorResponse(const std::string& message);
-    long getCurrentTimestamp();
     bool validateParameters(const httplib::Request& req,
                             const std::vector<std::string>& required_params);
+    // Registry id of the symbol parameter, or -1 after answering 404
+    int lookupSymbol(const httplib::Request& req, httplib::Response& res);
+    // Admin routes only answer on loopback, false after answering 403
+    bool checkAdmin(const httplib::Request& req, httplib::Response& res);
+    void answerUniverseChange(const httplib::Request& req,
+                              httplib::Response& res, bool subscribe);
+    // Registry id of the name parameter, or -1 after answering 400/404
+    int lookupIndicator(const httplib::Request& req, httplib::Response& res);
+    // The shared path of every indicator route
+    void answerIndicator(const httplib::Request& req, httplib::Response& res,
+                         indicator_t indicator);
+    void answerIndicatorChange(const httplib::Request& req,
+                               httplib::Response& res, bool subscribe);
     value_t filterDataPoints(const value_t& data, size_t maxPoints = 200);
 };
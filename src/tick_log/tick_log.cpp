@@ -0,0 +1,238 @@
+#include "tick_log.hpp"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "../utils/file_writer.hpp"
+#include "../utils/setup.hpp"
+#include "../utils/symbol_registry.hpp"
+
+const uint32_t TickLog::VERSION = 1;
+const uint32_t TickLog::INDEX_STRIDE = 1024;
+
+static const char LOG_MAGIC[8] = "OKXTICK";
+static const char INDEX_MAGIC[8] = "OKXTIDX";
+
+typedef struct {
+    bool open;
+    int logFile;
+    int indexFile;
+    uint64_t count;
+} log_state_t;
+
+static log_state_t logs[MAX_SYMBOLS];
+static pthread_mutex_t logsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static tick_log_header_t makeHeader(const char* magic, uint32_t recordSize,
+                                    const std::string& symbol) {
+    tick_log_header_t header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, magic, sizeof header.magic);
+    header.version = TickLog::VERSION;
+    header.recordSize = recordSize;
+    header.indexStride = TickLog::INDEX_STRIDE;
+    strncpy(header.symbol, symbol.c_str(), sizeof header.symbol - 1);
+    return header;
+}
+
+static off_t fileSize(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return 0;
+    }
+    return st.st_size;
+}
+
+// Opens (or resumes) the log of a symbol. Existing files are continued,
+// dropping a torn trailing record left behind by a crash.
+static log_state_t openLog(const std::string& symbol) {
+    std::string path = TickLog::logPath(Setup::dataPath, symbol);
+    std::string idxPath = TickLog::indexPath(path);
+
+    log_state_t state;
+    state.open = true;
+    state.logFile = FileWriter::open(path);
+    state.indexFile = FileWriter::open(idxPath);
+    state.count = 0;
+
+    off_t size = fileSize(path);
+    if (size < (off_t)sizeof(tick_log_header_t)) {
+        if (size > 0 && truncate(path.c_str(), 0) != 0) {
+            std::cerr << "Failed to reset tick log " << path << std::endl;
+        }
+        tick_log_header_t header =
+            makeHeader(LOG_MAGIC, sizeof(tick_record_t), symbol);
+        FileWriter::write(state.logFile, &header, sizeof header);
+    } else {
+        off_t payload = size - sizeof(tick_log_header_t);
+        state.count = payload / sizeof(tick_record_t);
+        off_t aligned = sizeof(tick_log_header_t) +
+                        state.count * sizeof(tick_record_t);
+        if (aligned != size && truncate(path.c_str(), aligned) != 0) {
+            std::cerr << "Failed to trim tick log " << path << std::endl;
+        }
+    }
+
+    if (fileSize(idxPath) < (off_t)sizeof(tick_log_header_t)) {
+        tick_log_header_t header =
+            makeHeader(INDEX_MAGIC, sizeof(tick_index_entry_t), symbol);
+        FileWriter::write(state.indexFile, &header, sizeof header);
+    }
+
+    return state;
+}
+
+std::string TickLog::logPath(const std::string& directory,
+                             const std::string& symbol) {
+    return directory + "meas_" + symbol + ".bin";
+}
+
+std::string TickLog::indexPath(const std::string& logPath) {
+    return logPath.substr(0, logPath.size() - 4) + ".idx";
+}
+
+void TickLog::append(int symbol, const measurement_t& m, long delay) {
+    pthread_mutex_lock(&logsMutex);
+    log_state_t& state = logs[symbol];
+    if (!state.open) {
+        state = openLog(SymbolRegistry::name(symbol));
+    }
+
+    if (state.count % INDEX_STRIDE == 0) {
+        tick_index_entry_t entry = {m.ts, state.count};
+        FileWriter::write(state.indexFile, &entry, sizeof entry);
+    }
+
+    tick_record_t record = {m.px, m.sz, m.ts, (int32_t)delay, 0};
+    FileWriter::write(state.logFile, &record, sizeof record);
+    state.count++;
+    pthread_mutex_unlock(&logsMutex);
+}
+
+static const char* mapFile(const std::string& path, size_t& size) {
+    size = 0;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);  // The mapping stays valid
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    size = st.st_size;
+    return (const char*)data;
+}
+
+static bool validHeader(const tick_log_header_t* header, const char* magic,
+                        uint32_t recordSize) {
+    return memcmp(header->magic, magic, sizeof header->magic) == 0 &&
+           header->version == TickLog::VERSION &&
+           header->recordSize == recordSize;
+}
+
+bool TickLog::openReader(tick_log_reader_t& reader, const std::string& path) {
+    memset(&reader, 0, sizeof reader);
+
+    reader.data = mapFile(path, reader.dataSize);
+    if (reader.data == nullptr) {
+        std::cerr << "Failed to map tick log " << path << std::endl;
+        return false;
+    }
+
+    reader.header = (const tick_log_header_t*)reader.data;
+    if (reader.dataSize < sizeof(tick_log_header_t) ||
+        !validHeader(reader.header, LOG_MAGIC, sizeof(tick_record_t))) {
+        std::cerr << "Not a tick log: " << path << std::endl;
+        closeReader(reader);
+        return false;
+    }
+
+    reader.records =
+        (const tick_record_t*)(reader.data + sizeof(tick_log_header_t));
+    reader.count = (reader.dataSize - sizeof(tick_log_header_t)) /
+                   sizeof(tick_record_t);
+
+    // The index is optional, without it lookups search all records
+    reader.indexData = mapFile(indexPath(path), reader.indexSize);
+    if (reader.indexData != nullptr &&
+        reader.indexSize >= sizeof(tick_log_header_t) &&
+        validHeader((const tick_log_header_t*)reader.indexData, INDEX_MAGIC,
+                    sizeof(tick_index_entry_t))) {
+        reader.index = (const tick_index_entry_t*)(reader.indexData +
+                                                   sizeof(tick_log_header_t));
+        reader.indexCount = (reader.indexSize - sizeof(tick_log_header_t)) /
+                            sizeof(tick_index_entry_t);
+
+        // Entries written ahead of their records are not usable
+        while (reader.indexCount > 0 &&
+               reader.index[reader.indexCount - 1].record >= reader.count) {
+            reader.indexCount--;
+        }
+    }
+
+    return true;
+}
+
+void TickLog::closeReader(tick_log_reader_t& reader) {
+    if (reader.data != nullptr) {
+        munmap((void*)reader.data, reader.dataSize);
+    }
+    if (reader.indexData != nullptr) {
+        munmap((void*)reader.indexData, reader.indexSize);
+    }
+    memset(&reader, 0, sizeof reader);
+}
+
+size_t TickLog::lowerBound(const tick_log_reader_t& reader, long timestamp) {
+    size_t lo = 0;
+    size_t hi = reader.count;
+
+    // Narrow down to one block using the index: the answer lies after the
+    // last block starting before timestamp and no later than the next one
+    if (reader.indexCount > 0) {
+        const tick_index_entry_t* entry = std::lower_bound(
+            reader.index, reader.index + reader.indexCount, timestamp,
+            [](const tick_index_entry_t& e, long ts) { return e.ts < ts; });
+        size_t k = entry - reader.index;
+
+        if (k > 0) {
+            lo = reader.index[k - 1].record + 1;
+        }
+        if (k < reader.indexCount) {
+            hi = reader.index[k].record;
+        }
+    }
+
+    const tick_record_t* record = std::lower_bound(
+        reader.records + lo, reader.records + hi, timestamp,
+        [](const tick_record_t& r, long ts) { return r.ts < ts; });
+    return record - reader.records;
+}
+
+tick_range_t TickLog::range(const tick_log_reader_t& reader, long fromTs,
+                            long toTs) {
+    tick_range_t result;
+    result.begin = reader.records + lowerBound(reader, fromTs);
+    result.end = reader.records + lowerBound(reader, toTs);
+    if (result.end < result.begin) {
+        result.end = result.begin;
+    }
+    return result;
+}
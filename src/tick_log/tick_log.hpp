@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <cstddef>
+#include <string>
+
+#include "../measurement/measurement.hpp"
+
+// On-disk layout of data/meas_<symbol>.bin:
+//   tick_log_header_t, then tick_record_t repeated, in arrival order.
+// data/meas_<symbol>.idx holds the same header followed by one
+// tick_index_entry_t for every INDEX_STRIDE records.
+
+typedef struct {
+    char magic[8];  // "OKXTICK" or "OKXTIDX"
+    uint32_t version;
+    uint32_t recordSize;
+    uint32_t indexStride;
+    uint32_t reserved;
+    char symbol[40];
+} tick_log_header_t;
+
+typedef struct {
+    double px;
+    double sz;
+    int64_t ts;
+    int32_t delay;  // Receive time minus exchange time (ms)
+    uint32_t reserved;
+} tick_record_t;
+
+typedef struct {
+    int64_t ts;       // Timestamp of the first record of the block
+    uint64_t record;  // Record number of the first record of the block
+} tick_index_entry_t;
+
+// Read-only view of a tick log mapped into memory
+typedef struct {
+    const char* data;
+    size_t dataSize;
+    const char* indexData;
+    size_t indexSize;
+
+    const tick_log_header_t* header;
+    const tick_record_t* records;
+    size_t count;
+    const tick_index_entry_t* index;
+    size_t indexCount;
+} tick_log_reader_t;
+
+// Records [begin, end) pointing into the mapping, valid until closeReader
+typedef struct {
+    const tick_record_t* begin;
+    const tick_record_t* end;
+} tick_range_t;
+
+namespace TickLog {
+
+extern const uint32_t VERSION;
+extern const uint32_t INDEX_STRIDE;
+
+std::string logPath(const std::string& directory, const std::string& symbol);
+std::string indexPath(const std::string& logPath);
+
+// Queues a record (and index entry when due) on the file writer. symbol is
+// a SymbolRegistry id.
+void append(int symbol, const measurement_t& m, long delay);
+
+bool openReader(tick_log_reader_t& reader, const std::string& path);
+void closeReader(tick_log_reader_t& reader);
+
+// Position of the first record with ts >= timestamp
+size_t lowerBound(const tick_log_reader_t& reader, long timestamp);
+
+// Records with fromTs <= ts < toTs
+tick_range_t range(const tick_log_reader_t& reader, long fromTs, long toTs);
+
+}  // namespace TickLog
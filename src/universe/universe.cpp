@@ -0,0 +1,176 @@
+#include "universe.hpp"
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "../bars/bars.hpp"
+#include "../data_collector/data_collector.hpp"
+#include "../measurement/measurement.hpp"
+#include "../utils/symbol_registry.hpp"
+
+const std::vector<std::string> Universe::DEFAULT_SYMBOLS = {
+    "BTC-USDT", "ADA-USDT", "ETH-USDT", "DOGE-USDT",
+    "XRP-USDT", "SOL-USDT", "LTC-USDT", "BNB-USDT"};
+
+static const size_t MAX_NAME_LENGTH = 32;
+
+static std::atomic<bool> activeFlags[MAX_SYMBOLS];
+static std::vector<int> active;  // In subscription order
+static pthread_mutex_t universeMutex = PTHREAD_MUTEX_INITIALIZER;
+static universe_listener_t listener = nullptr;
+static void* listenerUser = nullptr;
+
+bool Universe::validName(const std::string& name) {
+    if (name.empty() || name.size() > MAX_NAME_LENGTH) {
+        return false;
+    }
+    for (char c : name) {
+        if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool addName(const std::string& name, std::vector<std::string>& names) {
+    if (!Universe::validName(name)) {
+        std::cerr << "Invalid symbol: " << name << std::endl;
+        return false;
+    }
+    if (std::find(names.begin(), names.end(), name) == names.end()) {
+        names.push_back(name);
+    }
+    return true;
+}
+
+bool Universe::parseList(const std::string& list,
+                         std::vector<std::string>& names) {
+    std::stringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        if (!name.empty() && !addName(name, names)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Universe::loadFile(const std::string& path,
+                        std::vector<std::string>& names) {
+    std::ifstream file(path.c_str());
+    if (!file.is_open()) {
+        std::cerr << "Failed to open symbols file: " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+
+        std::stringstream stream(line);
+        std::string name;
+        if (stream >> name && !addName(name, names)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<int> Universe::init(const std::vector<std::string>& names) {
+    pthread_mutex_lock(&universeMutex);
+    for (const std::string& name : names) {
+        int symbol = SymbolRegistry::intern(name);
+        if (symbol < 0) {
+            std::cerr << "Symbol limit reached, skipping " << name
+                      << std::endl;
+            continue;
+        }
+        if (!activeFlags[symbol]) {
+            activeFlags[symbol] = true;
+            active.push_back(symbol);
+        }
+    }
+    std::vector<int> symbols = active;
+    pthread_mutex_unlock(&universeMutex);
+
+    return symbols;
+}
+
+void Universe::setListener(universe_listener_t newListener, void* user) {
+    pthread_mutex_lock(&universeMutex);
+    listener = newListener;
+    listenerUser = user;
+    pthread_mutex_unlock(&universeMutex);
+}
+
+universe_result_t Universe::subscribe(const std::string& name) {
+    if (!validName(name)) {
+        return UNIVERSE_INVALID;
+    }
+
+    pthread_mutex_lock(&universeMutex);
+    int symbol = SymbolRegistry::intern(name);
+    universe_result_t result = UNIVERSE_OK;
+
+    if (symbol < 0) {
+        result = UNIVERSE_FULL;
+    } else if (activeFlags[symbol]) {
+        result = UNIVERSE_UNCHANGED;
+    } else {
+        activeFlags[symbol] = true;
+        active.push_back(symbol);
+        if (listener != nullptr) {
+            listener(name, true, listenerUser);
+        }
+    }
+
+    pthread_mutex_unlock(&universeMutex);
+    return result;
+}
+
+universe_result_t Universe::unsubscribe(const std::string& name) {
+    // Never intern here, unknown names must not use up ids
+    int symbol = SymbolRegistry::lookup(name);
+    if (symbol < 0) {
+        return validName(name) ? UNIVERSE_UNCHANGED : UNIVERSE_INVALID;
+    }
+
+    pthread_mutex_lock(&universeMutex);
+    universe_result_t result = UNIVERSE_UNCHANGED;
+
+    if (activeFlags[symbol]) {
+        activeFlags[symbol] = false;
+        active.erase(std::find(active.begin(), active.end(), symbol));
+        if (listener != nullptr) {
+            listener(name, false, listenerUser);
+        }
+
+        // Give the history back, a later subscribe starts from scratch
+        Measurement::clearSymbol(symbol);
+        DataCollector::clearSymbol(symbol);
+        Bars::clearSymbol(symbol);
+        result = UNIVERSE_OK;
+    }
+
+    pthread_mutex_unlock(&universeMutex);
+    return result;
+}
+
+bool Universe::isActive(int symbol) {
+    return activeFlags[symbol].load(std::memory_order_relaxed);
+}
+
+std::vector<int> Universe::activeSymbols() {
+    pthread_mutex_lock(&universeMutex);
+    std::vector<int> symbols = active;
+    pthread_mutex_unlock(&universeMutex);
+    return symbols;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+typedef enum {
+    UNIVERSE_OK,
+    UNIVERSE_UNCHANGED,  // Already in the requested state
+    UNIVERSE_INVALID,    // Not an instrument name
+    UNIVERSE_FULL,       // SymbolRegistry has no ids left
+} universe_result_t;
+
+// Called after a symbol was added to or removed from the universe
+typedef void (*universe_listener_t)(const std::string& symbol, bool active,
+                                    void* user);
+
+// The set of instruments currently tracked. Symbols can join and leave at
+// runtime; their registry ids stay reserved so they can come back later.
+namespace Universe {
+
+extern const std::vector<std::string> DEFAULT_SYMBOLS;
+
+// Instrument names like BTC-USDT: upper-case letters, digits and dashes
+bool validName(const std::string& name);
+
+// Comma-separated list, e.g. from --symbols
+bool parseList(const std::string& list, std::vector<std::string>& names);
+
+// One instrument per line, blank lines and # comments are skipped
+bool loadFile(const std::string& path, std::vector<std::string>& names);
+
+// Activates the startup symbols, returns their ids
+std::vector<int> init(const std::vector<std::string>& names);
+
+void setListener(universe_listener_t listener, void* user);
+
+universe_result_t subscribe(const std::string& name);
+universe_result_t unsubscribe(const std::string& name);
+
+bool isActive(int symbol);  // Lock-free
+std::vector<int> activeSymbols();
+
+}  // namespace Universe
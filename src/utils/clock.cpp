@@ -0,0 +1,29 @@
+#include "clock.hpp"
+
+#include <atomic>
+#include <chrono>
+
+static std::atomic<bool> virtualMode(false);
+static std::atomic<long> virtualNow(0);
+
+long Clock::nowMs() {
+    if (virtualMode.load(std::memory_order_relaxed)) {
+        return virtualNow.load(std::memory_order_relaxed);
+    }
+
+    auto now = std::chrono::system_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               now.time_since_epoch())
+        .count();
+}
+
+void Clock::setVirtualTime(long timestampMs) {
+    virtualNow.store(timestampMs, std::memory_order_relaxed);
+    virtualMode.store(true, std::memory_order_relaxed);
+}
+
+void Clock::useSystemTime() {
+    virtualMode.store(false, std::memory_order_relaxed);
+}
+
+bool Clock::isVirtual() { return virtualMode; }
@@ -0,0 +1,12 @@
+#pragma once
+
+// Wall-clock time in milliseconds for the whole pipeline. Replay switches it
+// to a virtual clock that only moves when the replayed data says so.
+namespace Clock {
+
+long nowMs();
+void setVirtualTime(long timestampMs);
+void useSystemTime();
+bool isVirtual();
+
+}  // namespace Clock
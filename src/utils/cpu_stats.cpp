@@ -5,6 +5,7 @@
 #include <sstream>
 #include <string>
 
+#include "file_writer.hpp"
 #include "setup.hpp"
 
 cpu_stats_t CpuStats::prev = {0};
@@ -48,17 +49,10 @@ double CpuStats::getCpuIdlePercentage() {
 }
 
 void CpuStats::writeCpuStats(long timestamp, double idlePercentage) {
-    std::string filePath = Setup::dataPath + "cpu_stats.txt";
+    static const int cpuStatsFile =
+        FileWriter::open(Setup::dataPath + "cpu_stats.txt");
 
-    FILE* fp = fopen(filePath.c_str(), "a");
-    if (fp == NULL) {
-        std::cerr << "Failed to write CPU stats to file: " << filePath
-                  << std::endl;
-        return;
-    }
-
-    fprintf(fp, "%ld %.2f\n", timestamp, idlePercentage);
-    fclose(fp);
+    FileWriter::format(cpuStatsFile, "%ld %.2f\n", timestamp, idlePercentage);
 
     std::cout << "CPU idle percentage: " << idlePercentage << "%" << std::endl;
 }
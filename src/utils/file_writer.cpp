@@ -0,0 +1,204 @@
+#include "file_writer.hpp"
+
+#include <pthread.h>
+#include <time.h>
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+const long FileWriter::DEFAULT_FLUSH_INTERVAL_MS = 1000;
+const size_t FileWriter::DEFAULT_FLUSH_BYTES = 64 * 1024;
+const size_t FileWriter::MAX_PENDING_BYTES = 8 * 1024 * 1024;
+
+typedef struct {
+    int handle;
+    size_t offset;
+    size_t len;
+} record_t;
+
+typedef struct {
+    std::vector<record_t> records;
+    std::vector<char> bytes;
+} batch_t;
+
+static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writerCondition = PTHREAD_COND_INITIALIZER;
+static pthread_t writerThread;
+static bool running = false;
+static long flushInterval = FileWriter::DEFAULT_FLUSH_INTERVAL_MS;
+static size_t flushThreshold = FileWriter::DEFAULT_FLUSH_BYTES;
+
+// Guarded by writerMutex
+static std::vector<std::string> paths;
+static batch_t pending;
+static std::atomic<unsigned long> dropped(0);
+
+// Only touched by the writer thread (or by stop() after it has exited)
+static std::vector<FILE*> files;
+
+static void writeBatch(const batch_t& batch) {
+    std::vector<bool> touched(files.size(), false);
+
+    for (const record_t& record : batch.records) {
+        if (record.handle >= (int)files.size()) {
+            files.resize(record.handle + 1, nullptr);
+            touched.resize(record.handle + 1, false);
+        }
+
+        FILE*& fp = files[record.handle];
+        if (fp == nullptr) {
+            pthread_mutex_lock(&writerMutex);
+            std::string path = paths[record.handle];
+            pthread_mutex_unlock(&writerMutex);
+
+            fp = fopen(path.c_str(), "a");
+            if (fp == NULL) {
+                std::cout << "Error opening the file " << path << std::endl;
+                continue;
+            }
+            setvbuf(fp, nullptr, _IOFBF, 64 * 1024);
+        }
+
+        fwrite(&batch.bytes[record.offset], 1, record.len, fp);
+        touched[record.handle] = true;
+    }
+
+    for (size_t i = 0; i < files.size(); i++) {
+        if (touched[i]) {
+            fflush(files[i]);
+        }
+    }
+}
+
+static void* writerThreadFunction(void* arg) {
+    batch_t batch;
+
+    pthread_mutex_lock(&writerMutex);
+    while (true) {
+        if (running && pending.bytes.size() < flushThreshold) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += flushInterval / 1000;
+            deadline.tv_nsec += (flushInterval % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&writerCondition, &writerMutex, &deadline);
+        }
+
+        // Swap buffers so producers keep appending while we hit the disk
+        std::swap(batch, pending);
+        bool exiting = !running;
+        pthread_mutex_unlock(&writerMutex);
+
+        writeBatch(batch);
+        batch.records.clear();
+        batch.bytes.clear();
+
+        if (exiting) {
+            break;
+        }
+        pthread_mutex_lock(&writerMutex);
+    }
+
+    return nullptr;
+}
+
+void FileWriter::start(long flushIntervalMs, size_t flushBytes) {
+    pthread_mutex_lock(&writerMutex);
+    if (running) {
+        pthread_mutex_unlock(&writerMutex);
+        return;
+    }
+    flushInterval = flushIntervalMs > 0 ? flushIntervalMs : 1;
+    flushThreshold = flushBytes;
+    running = true;
+    pthread_mutex_unlock(&writerMutex);
+
+    pthread_create(&writerThread, nullptr, writerThreadFunction, nullptr);
+}
+
+void FileWriter::stop() {
+    pthread_mutex_lock(&writerMutex);
+    if (!running) {
+        pthread_mutex_unlock(&writerMutex);
+        return;
+    }
+    running = false;
+    pthread_cond_signal(&writerCondition);
+    pthread_mutex_unlock(&writerMutex);
+
+    pthread_join(writerThread, nullptr);
+
+    for (FILE*& fp : files) {
+        if (fp != nullptr) {
+            fclose(fp);
+            fp = nullptr;
+        }
+    }
+}
+
+int FileWriter::open(const std::string& path) {
+    pthread_mutex_lock(&writerMutex);
+
+    int handle = -1;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (paths[i] == path) {
+            handle = i;
+            break;
+        }
+    }
+    if (handle < 0) {
+        paths.push_back(path);
+        handle = paths.size() - 1;
+    }
+
+    pthread_mutex_unlock(&writerMutex);
+    return handle;
+}
+
+void FileWriter::write(int handle, const void* data, size_t len) {
+    pthread_mutex_lock(&writerMutex);
+
+    if (pending.bytes.size() + len > MAX_PENDING_BYTES) {
+        pthread_mutex_unlock(&writerMutex);
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    record_t record = {handle, pending.bytes.size(), len};
+    pending.records.push_back(record);
+    pending.bytes.insert(pending.bytes.end(), (const char*)data,
+                         (const char*)data + len);
+
+    if (pending.bytes.size() >= flushThreshold) {
+        pthread_cond_signal(&writerCondition);
+    }
+
+    pthread_mutex_unlock(&writerMutex);
+}
+
+void FileWriter::format(int handle, const char* fmt, ...) {
+    char line[512];
+
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof line, fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof line) {
+        len = sizeof line - 1;
+    }
+
+    write(handle, line, len);
+}
+
+unsigned long FileWriter::droppedRecords() { return dropped; }
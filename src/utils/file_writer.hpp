@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace FileWriter {
+
+extern const long DEFAULT_FLUSH_INTERVAL_MS;
+extern const size_t DEFAULT_FLUSH_BYTES;
+extern const size_t MAX_PENDING_BYTES;
+
+// Starts the writer thread. Pending records are written out every
+// flushIntervalMs, or earlier once flushBytes have queued up.
+void start(long flushIntervalMs = DEFAULT_FLUSH_INTERVAL_MS,
+           size_t flushBytes = DEFAULT_FLUSH_BYTES);
+
+// Writes out everything still queued and closes all files
+void stop();
+
+// Returns a handle for path, the same one for repeated calls. The file is
+// opened for appending by the writer thread and kept open.
+int open(const std::string& path);
+
+// Queues a copy of data for the file, never touches the disk itself. Records
+// are dropped (and counted) while more than MAX_PENDING_BYTES are queued.
+void write(int handle, const void* data, size_t len);
+
+// printf-style convenience around write()
+void format(int handle, const char* fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+unsigned long droppedRecords();
+
+}  // namespace FileWriter
@@ -8,22 +8,33 @@
 #include <iostream>
 
 const std::string Setup::dataPath = "data/";
-const std::string Setup::files[] = {
-    "meas_BTC-USDT.txt",  "meas_ADA-USDT.txt", "meas_ETH-USDT.txt",
-    "meas_DOGE-USDT.txt", "meas_XRP-USDT.txt", "meas_SOL-USDT.txt",
-    "meas_LTC-USDT.txt",  "meas_BNB-USDT.txt", "average.txt",
-    "pearson.txt",        "cpu_stats.txt"};
 
-void Setup::initializeFiles() {
+std::vector<std::string> Setup::files(const std::vector<std::string>& symbols) {
+    std::vector<std::string> names;
+    for (const std::string& symbol : symbols) {
+        names.push_back("meas_" + symbol + ".bin");
+        names.push_back("meas_" + symbol + ".idx");
+        names.push_back("meas_" + symbol + ".txt");
+    }
+    names.push_back("average.txt");
+    names.push_back("pearson.txt");
+    names.push_back("cpu_stats.txt");
+    return names;
+}
+
+void Setup::initializeFiles(const std::vector<std::string>& symbols,
+                            bool keepExisting) {
     int status = mkdir(dataPath.c_str(), 0777);
 
     if (status != 0 && errno != EEXIST) {
         std::cerr << "Error creating directory " << dataPath << ": "
                   << strerror(errno) << std::endl;
     } else {
-        for (const std::string& file : files) {
+        for (const std::string& file : files(symbols)) {
             std::string filePath = dataPath + file;
-            std::ofstream outFile(filePath.c_str());
+            std::ios::openmode mode =
+                keepExisting ? std::ios::app : std::ios::trunc;
+            std::ofstream outFile(filePath.c_str(), mode);
 
             if (outFile.is_open()) {
                 outFile.close();
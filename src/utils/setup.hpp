@@ -1,12 +1,18 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 namespace Setup {
 
 extern const std::string dataPath;
-extern const std::string files[];
 
-void initializeFiles();
+// Output files of the given symbols plus the shared ones
+std::vector<std::string> files(const std::vector<std::string>& symbols);
+
+// Creates data/ and empties the output files. A warm restart keeps what they
+// hold and only creates the missing ones.
+void initializeFiles(const std::vector<std::string>& symbols,
+                     bool keepExisting = false);
 
 }  // namespace Setup
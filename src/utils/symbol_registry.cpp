@@ -0,0 +1,80 @@
+#include "symbol_registry.hpp"
+
+#include <pthread.h>
+
+#include <atomic>
+#include <cstring>
+
+// Open addressing table of id + 1 (0 marks an empty slot), at most half full
+#define HASH_SLOTS (MAX_SYMBOLS * 2)
+
+static std::string names[MAX_SYMBOLS];
+static std::atomic<int> slots[HASH_SLOTS];
+static std::atomic<int> symbolCount(0);
+static pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// FNV-1a
+static size_t hashName(const char* name, size_t len) {
+    size_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+int SymbolRegistry::lookup(const char* name, size_t len) {
+    size_t slot = hashName(name, len) % HASH_SLOTS;
+
+    while (true) {
+        int entry = slots[slot].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return -1;
+        }
+
+        // The name is written before its slot is published
+        const std::string& candidate = names[entry - 1];
+        if (candidate.size() == len &&
+            memcmp(candidate.data(), name, len) == 0) {
+            return entry - 1;
+        }
+
+        slot = (slot + 1) % HASH_SLOTS;
+    }
+}
+
+int SymbolRegistry::lookup(const std::string& name) {
+    return lookup(name.data(), name.size());
+}
+
+int SymbolRegistry::intern(const std::string& name) {
+    int id = lookup(name);
+    if (id >= 0) {
+        return id;
+    }
+
+    pthread_mutex_lock(&registryMutex);
+
+    // Someone else may have added it meanwhile
+    id = lookup(name);
+    if (id < 0 && symbolCount < MAX_SYMBOLS) {
+        id = symbolCount;
+        names[id] = name;
+
+        size_t slot = hashName(name.data(), name.size()) % HASH_SLOTS;
+        while (slots[slot].load(std::memory_order_relaxed) != 0) {
+            slot = (slot + 1) % HASH_SLOTS;
+        }
+        slots[slot].store(id + 1, std::memory_order_release);
+        symbolCount.store(id + 1, std::memory_order_release);
+    }
+
+    pthread_mutex_unlock(&registryMutex);
+    return id;
+}
+
+const std::string& SymbolRegistry::name(int id) { return names[id]; }
+
+int SymbolRegistry::count() {
+    return symbolCount.load(std::memory_order_acquire);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Upper bound on instruments, all per-symbol storage is sized by it
+#define MAX_SYMBOLS 1024
+
+// Interns instrument names into dense ids 0..count()-1. Ids are never
+// reused, so they can index flat per-symbol arrays everywhere.
+namespace SymbolRegistry {
+
+// Returns the id of name, adding it if needed. -1 when the registry is full.
+int intern(const std::string& name);
+
+// Lock-free lookups, -1 for unknown names
+int lookup(const char* name, size_t len);
+int lookup(const std::string& name);
+
+const std::string& name(int id);
+int count();
+
+}  // namespace SymbolRegistry
@@ -0,0 +1,159 @@
+#include "worker_pool.hpp"
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <vector>
+
+// One run() at a time owns the pool, in the order they asked for it, so a
+// caller waits for the runs queued ahead of it and no more
+static pthread_mutex_t turnMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t turnCondition = PTHREAD_COND_INITIALIZER;
+static unsigned long nextTicket = 0;
+static unsigned long nowServing = 0;
+
+static pthread_mutex_t poolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workCondition = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t doneCondition = PTHREAD_COND_INITIALIZER;
+static std::vector<pthread_t> workers;
+static bool running = false;
+
+// The current job, guarded by poolMutex except for nextIndex
+static pool_task_t jobTask = nullptr;
+static void* jobArg = nullptr;
+static size_t jobCount = 0;
+static unsigned long generation = 0;  // Bumped for every job
+static int busyWorkers = 0;           // Workers not yet done with the job
+static std::atomic<size_t> nextIndex(0);
+
+// Tasks are claimed one index at a time, so a slow symbol only holds up
+// the thread it landed on
+static void drain(pool_task_t task, void* arg, size_t count) {
+    size_t index;
+    while ((index = nextIndex.fetch_add(1, std::memory_order_relaxed)) <
+           count) {
+        task(index, arg);
+    }
+}
+
+static void takeTurn() {
+    pthread_mutex_lock(&turnMutex);
+    unsigned long ticket = nextTicket++;
+    while (nowServing != ticket) {
+        pthread_cond_wait(&turnCondition, &turnMutex);
+    }
+    pthread_mutex_unlock(&turnMutex);
+}
+
+static void endTurn() {
+    pthread_mutex_lock(&turnMutex);
+    nowServing++;
+    pthread_cond_broadcast(&turnCondition);
+    pthread_mutex_unlock(&turnMutex);
+}
+
+static void* workerThread(void* arg) {
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&poolMutex);
+    while (true) {
+        while (running && generation == seen) {
+            pthread_cond_wait(&workCondition, &poolMutex);
+        }
+        if (!running) {
+            break;
+        }
+
+        seen = generation;
+        pool_task_t task = jobTask;
+        void* taskArg = jobArg;
+        size_t count = jobCount;
+        pthread_mutex_unlock(&poolMutex);
+
+        drain(task, taskArg, count);
+
+        pthread_mutex_lock(&poolMutex);
+        if (--busyWorkers == 0) {
+            pthread_cond_signal(&doneCondition);
+        }
+    }
+    pthread_mutex_unlock(&poolMutex);
+
+    return nullptr;
+}
+
+void WorkerPool::start(int threads) {
+    if (threads <= 0) {
+        threads = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    takeTurn();
+    pthread_mutex_lock(&poolMutex);
+    if (running) {
+        pthread_mutex_unlock(&poolMutex);
+        endTurn();
+        return;
+    }
+    running = true;
+    pthread_mutex_unlock(&poolMutex);
+
+    // The caller of run() is the remaining thread
+    workers.resize(threads > 1 ? threads - 1 : 0);
+    for (pthread_t& worker : workers) {
+        pthread_create(&worker, nullptr, workerThread, nullptr);
+    }
+    endTurn();
+}
+
+void WorkerPool::stop() {
+    takeTurn();
+    pthread_mutex_lock(&poolMutex);
+    running = false;
+    pthread_cond_broadcast(&workCondition);
+    pthread_mutex_unlock(&poolMutex);
+
+    for (pthread_t worker : workers) {
+        pthread_join(worker, nullptr);
+    }
+    workers.clear();
+    endTurn();
+}
+
+int WorkerPool::threads() {
+    takeTurn();
+    int count = workers.size() + 1;
+    endTurn();
+    return count;
+}
+
+void WorkerPool::run(size_t count, pool_task_t task, void* arg) {
+    takeTurn();
+
+    nextIndex.store(0, std::memory_order_relaxed);
+    if (workers.empty() || count < 2) {
+        drain(task, arg, count);
+        endTurn();
+        return;
+    }
+
+    pthread_mutex_lock(&poolMutex);
+    jobTask = task;
+    jobArg = arg;
+    jobCount = count;
+    busyWorkers = workers.size();
+    generation++;
+    pthread_cond_broadcast(&workCondition);
+    pthread_mutex_unlock(&poolMutex);
+
+    drain(task, arg, count);
+
+    // Barrier: every task has returned once the last worker checks in
+    pthread_mutex_lock(&poolMutex);
+    while (busyWorkers > 0) {
+        pthread_cond_wait(&doneCondition, &poolMutex);
+    }
+    pthread_mutex_unlock(&poolMutex);
+
+    endTurn();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+typedef void (*pool_task_t)(size_t index, void* arg);
+
+// Fixed set of threads shared by the per-tick computations. Without a
+// started pool everything runs inline on the calling thread.
+namespace WorkerPool {
+
+// Sizes the pool to threads, counting the thread that calls run(), so one
+// thread starts no workers. 0 means one per online core.
+void start(int threads = 0);
+
+// Joins the workers, waiting for a run() in progress to finish first
+void stop();
+
+int threads();  // Threads taking part in run(), at least 1
+
+// Calls task(i, arg) for every i in [0, count) across the pool and the
+// calling thread, returning only once every call has finished. Concurrent
+// callers take turns in the order they called.
+void run(size_t count, pool_task_t task, void* arg);
+
+}  // namespace WorkerPool
@@ -1,42 +1,196 @@
 #include "okx_client.hpp"
 
+#include <unistd.h>
+
+#include <algorithm>
 #include <iostream>
 
 #include "../measurement/measurement.hpp"
+#include "../metrics/latency.hpp"
+#include "../universe/universe.hpp"
+#include "../utils/clock.hpp"
+#include "../utils/symbol_registry.hpp"
+#include "trade_parser.hpp"
 
-char OkxClient::rx_buffer[16384];
-int OkxClient::rx_buffer_len = 0;
-
-static okx_client_t* current_client = nullptr;
+// lws context creation (and the SSL global init it does) is not safe to run
+// concurrently from several service threads
+static pthread_mutex_t contextMutex = PTHREAD_MUTEX_INITIALIZER;
 
 static const struct lws_protocols protocols[] = {
     {
         "okx-protocol",
         OkxClient::wsCallback,
         0,  // per_session_data_size
-        16384,
+        RX_BUFFER_SIZE,
     },
     {NULL, NULL, 0, 0}  // terminator
 };
 
-okx_client_t OkxClient::create(const std::vector<std::string>& symbols) {
-    okx_client_t client;
-    client.symbols = symbols;
-    client.context = nullptr;
-    client.client_wsi = nullptr;
-    client.subscription_confirmed = false;
+const okx_endpoint_t OkxClient::DEFAULT_ENDPOINT = {"ws.okx.com", 8443,
+                                                    "/ws/v5/public", true};
+
+okx_client_t* OkxClient::create(const std::vector<std::string>& symbols,
+                                int numConnections,
+                                const okx_endpoint_t& endpoint) {
+    okx_client_t* client = new okx_client_t();
+
+    // Connections may start without symbols, they get them at runtime
+    if (numConnections < 1) {
+        numConnections = 1;
+    }
+
+    for (int i = 0; i < numConnections; i++) {
+        okx_connection_t* connection = new okx_connection_t();
+        connection->id = i;
+        pthread_mutex_init(&connection->symbolsMutex, nullptr);
+        connection->hasPendingOps = false;
+        connection->endpoint = endpoint;
+        connection->context = nullptr;
+        connection->client_wsi = nullptr;
+        connection->subscription_confirmed = false;
+        connection->running = false;
+        connection->failed = false;
+        connection->thread = 0;
+        connection->rx_buffer_len = 0;
+        connection->rx_overflow = false;
+        connection->oversized = 0;
+        connection->rx_start_ms = 0;
+        connection->rx_start_ns = 0;
+        TickQueue::init(connection->queue, TICK_QUEUE_CAPACITY);
+        client->connections.push_back(connection);
+    }
+
+    // Deal the symbols out round-robin so shards stay balanced
+    for (size_t i = 0; i < symbols.size(); i++) {
+        client->connections[i % numConnections]->symbols.push_back(
+            symbols[i]);
+    }
+
     return client;
 }
 
+bool OkxClient::parseEndpoint(const std::string& url,
+                              okx_endpoint_t& endpoint) {
+    size_t hostStart;
+    if (url.compare(0, 6, "wss://") == 0) {
+        endpoint.ssl = true;
+        endpoint.port = 443;
+        hostStart = 6;
+    } else if (url.compare(0, 5, "ws://") == 0) {
+        endpoint.ssl = false;
+        endpoint.port = 80;
+        hostStart = 5;
+    } else {
+        return false;
+    }
+
+    size_t pathStart = url.find('/', hostStart);
+    std::string hostPort = url.substr(hostStart, pathStart - hostStart);
+    endpoint.path =
+        pathStart == std::string::npos ? "/" : url.substr(pathStart);
+
+    size_t colon = hostPort.find(':');
+    if (colon != std::string::npos) {
+        try {
+            endpoint.port = std::stoi(hostPort.substr(colon + 1));
+        } catch (const std::exception& e) {
+            return false;
+        }
+        hostPort = hostPort.substr(0, colon);
+    }
+
+    endpoint.address = hostPort;
+    return !endpoint.address.empty();
+}
+
 void OkxClient::destroy(okx_client_t& client) {
-    if (client.context) {
-        lws_context_destroy(client.context);
-        client.context = nullptr;
-        client.client_wsi = nullptr;
+    stop(client);
+
+    for (okx_connection_t* connection : client.connections) {
+        pthread_mutex_destroy(&connection->symbolsMutex);
+        delete connection;
     }
+    client.connections.clear();
 }
 
-bool OkxClient::connect(okx_client_t& client) {
+void OkxClient::start(okx_client_t& client) {
+    for (okx_connection_t* connection : client.connections) {
+        if (!connection->running) {
+            connection->running = true;
+            connection->failed = false;
+            pthread_create(&connection->thread, nullptr, connectionThread,
+                           connection);
+        }
+    }
+}
+
+void OkxClient::stop(okx_client_t& client) {
+    for (okx_connection_t* connection : client.connections) {
+        // Service threads notice this within one lws_service timeout
+        connection->running = false;
+    }
+
+    for (okx_connection_t* connection : client.connections) {
+        if (connection->thread) {
+            pthread_join(connection->thread, nullptr);
+            connection->thread = 0;
+        }
+    }
+}
+
+bool OkxClient::isRunning(const okx_client_t& client) {
+    for (const okx_connection_t* connection : client.connections) {
+        if (connection->failed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void OkxClient::subscribe(okx_client_t& client, const std::string& symbol) {
+    okx_connection_t* target = nullptr;
+    size_t fewest = 0;
+
+    for (okx_connection_t* connection : client.connections) {
+        pthread_mutex_lock(&connection->symbolsMutex);
+        size_t count = connection->symbols.size();
+        pthread_mutex_unlock(&connection->symbolsMutex);
+
+        if (target == nullptr || count < fewest) {
+            target = connection;
+            fewest = count;
+        }
+    }
+    if (target == nullptr) {
+        return;
+    }
+
+    okx_subscription_op_t op = {true, symbol};
+    pthread_mutex_lock(&target->symbolsMutex);
+    target->symbols.push_back(symbol);
+    target->pendingOps.push_back(op);
+    target->hasPendingOps = true;
+    pthread_mutex_unlock(&target->symbolsMutex);
+}
+
+void OkxClient::unsubscribe(okx_client_t& client, const std::string& symbol) {
+    okx_subscription_op_t op = {false, symbol};
+
+    for (okx_connection_t* connection : client.connections) {
+        pthread_mutex_lock(&connection->symbolsMutex);
+        std::vector<std::string>& symbols = connection->symbols;
+        std::vector<std::string>::iterator it =
+            std::find(symbols.begin(), symbols.end(), symbol);
+        if (it != symbols.end()) {
+            symbols.erase(it);
+            connection->pendingOps.push_back(op);
+            connection->hasPendingOps = true;
+        }
+        pthread_mutex_unlock(&connection->symbolsMutex);
+    }
+}
+
+bool OkxClient::connect(okx_connection_t& connection) {
     struct lws_context_creation_info info;
     memset(&info, 0, sizeof info);
 
@@ -45,6 +199,7 @@ bool OkxClient::connect(okx_client_t& client) {
     info.gid = -1;
     info.uid = -1;
     info.options = LWS_SERVER_OPTION_DO_SSL_GLOBAL_INIT;
+    info.user = &connection;  // Handed back in wsCallback
 
     // Add these options for better connection stability
     info.retry_and_idle_policy = NULL;  // Use defaults
@@ -53,8 +208,11 @@ bool OkxClient::connect(okx_client_t& client) {
     info.ka_interval = 10;  // Keep-alive interval
     info.ka_probes = 3;     // Number of keep-alive probes
 
-    client.context = lws_create_context(&info);
-    if (!client.context) {
+    pthread_mutex_lock(&contextMutex);
+    connection.context = lws_create_context(&info);
+    pthread_mutex_unlock(&contextMutex);
+
+    if (!connection.context) {
         std::cerr << "lws init failed" << std::endl;
         return false;
     }
@@ -62,114 +220,234 @@ bool OkxClient::connect(okx_client_t& client) {
     struct lws_client_connect_info ccinfo;
     memset(&ccinfo, 0, sizeof ccinfo);
 
-    ccinfo.context = client.context;
-    ccinfo.address = "ws.okx.com";
-    ccinfo.port = 8443;
-    ccinfo.path = "/ws/v5/public";
+    ccinfo.context = connection.context;
+    ccinfo.address = connection.endpoint.address.c_str();
+    ccinfo.port = connection.endpoint.port;
+    ccinfo.path = connection.endpoint.path.c_str();
     ccinfo.host = ccinfo.address;
     ccinfo.origin = ccinfo.address;
     ccinfo.protocol = protocols[0].name;
-    ccinfo.ssl_connection = LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED;
+    if (connection.endpoint.ssl) {
+        ccinfo.ssl_connection = LCCSCF_USE_SSL | LCCSCF_ALLOW_SELFSIGNED;
+    }
 
     // Add retry settings
     ccinfo.retry_and_idle_policy = NULL;  // Use defaults
 
-    std::cout << "Connecting to OKX WebSocket..." << std::endl;
-    client.client_wsi = lws_client_connect_via_info(&ccinfo);
+    pthread_mutex_lock(&connection.symbolsMutex);
+    size_t symbolCount = connection.symbols.size();
+    pthread_mutex_unlock(&connection.symbolsMutex);
 
-    // Store the pointer after establishing connection attempt
-    if (client.client_wsi != nullptr) {
-        current_client = &client;
-    }
+    std::cout << "Connecting to " << connection.endpoint.address << ":"
+              << connection.endpoint.port << " (connection " << connection.id
+              << ", " << symbolCount << " symbols)..." << std::endl;
+    connection.subscription_confirmed = false;
+    connection.rx_buffer_len = 0;
+    connection.rx_overflow = false;
+    connection.client_wsi = lws_client_connect_via_info(&ccinfo);
+
+    return connection.client_wsi != nullptr;
+}
 
-    return client.client_wsi != nullptr;
+void OkxClient::disconnect(okx_connection_t& connection) {
+    if (connection.context) {
+        lws_context_destroy(connection.context);
+        connection.context = nullptr;
+        connection.client_wsi = nullptr;
+    }
+    connection.subscription_confirmed = false;
 }
 
-void OkxClient::sendSubscription(okx_client_t& client) {
+static std::string subscriptionMessage(
+    const char* op, const std::vector<std::string>& symbols) {
     // Create a JSON subscription message
     nlohmann::json subscription = nlohmann::json::object();
     nlohmann::json args = nlohmann::json::array();
 
     // Add each symbol to the subscription
-    for (const std::string& symbol : client.symbols) {
+    for (const std::string& symbol : symbols) {
         nlohmann::json arg = {{"channel", "trades"}, {"instId", symbol}};
         args.push_back(arg);
     }
 
-    subscription["op"] = "subscribe";
+    subscription["op"] = op;
     subscription["args"] = args;
+    return subscription.dump();
+}
 
-    // Send the message via WebSocket
-    std::string message = subscription.dump();
-
+static void sendText(struct lws* wsi, const std::string& message) {
     unsigned char* buf = (unsigned char*)malloc(LWS_PRE + message.length());
     memcpy(&buf[LWS_PRE], message.c_str(), message.length());
 
-    lws_write(client.client_wsi, &buf[LWS_PRE], message.length(),
-              LWS_WRITE_TEXT);
+    lws_write(wsi, &buf[LWS_PRE], message.length(), LWS_WRITE_TEXT);
     free(buf);
 }
 
+void OkxClient::sendSubscription(okx_connection_t& connection) {
+    // The full shard goes out, so earlier runtime changes are already in it
+    pthread_mutex_lock(&connection.symbolsMutex);
+    std::vector<std::string> symbols = connection.symbols;
+    connection.pendingOps.clear();
+    connection.hasPendingOps = false;
+    pthread_mutex_unlock(&connection.symbolsMutex);
+
+    if (symbols.empty()) {
+        // Nothing to wait for until a symbol is added at runtime
+        connection.subscription_confirmed = true;
+        return;
+    }
+
+    sendText(connection.client_wsi, subscriptionMessage("subscribe", symbols));
+}
+
+void OkxClient::sendPendingOp(okx_connection_t& connection) {
+    pthread_mutex_lock(&connection.symbolsMutex);
+    if (connection.pendingOps.empty()) {
+        connection.hasPendingOps = false;
+        pthread_mutex_unlock(&connection.symbolsMutex);
+        return;
+    }
+
+    okx_subscription_op_t op = connection.pendingOps.front();
+    connection.pendingOps.erase(connection.pendingOps.begin());
+    bool more = !connection.pendingOps.empty();
+    connection.hasPendingOps = more;
+    pthread_mutex_unlock(&connection.symbolsMutex);
+
+    std::vector<std::string> symbols(1, op.symbol);
+    sendText(connection.client_wsi,
+             subscriptionMessage(op.subscribe ? "subscribe" : "unsubscribe",
+                                 symbols));
+
+    // One write per writable callback
+    if (more) {
+        lws_callback_on_writable(connection.client_wsi);
+    }
+}
+
+// Hands a parsed trade to the ingest thread without blocking
+static void enqueueTrade(okx_connection_t& connection, const char* instId,
+                         size_t instIdLen, const measurement_t& m) {
+    // Trades still in flight after an unsubscribe are ignored
+    int symbol = SymbolRegistry::lookup(instId, instIdLen);
+    if (symbol < 0 || !Universe::isActive(symbol)) {
+        return;
+    }
+
+    long parsedAt = Latency::nowNs();
+    Latency::record(STAGE_EXCHANGE_TO_RECEIVE, symbol,
+                    (connection.rx_start_ms - m.ts) * 1000);
+    Latency::record(STAGE_RECEIVE_TO_PARSE, symbol,
+                    (parsedAt - connection.rx_start_ns) / 1000);
+
+    tick_t tick = {m, symbol, parsedAt};
+    TickQueue::push(connection.queue, tick);
+}
+
+static void storeTrade(const char* instId, size_t instIdLen,
+                       const measurement_t& m, void* user) {
+    enqueueTrade(*(okx_connection_t*)user, instId, instIdLen, m);
+}
+
+void OkxClient::handleMessage(okx_connection_t& connection,
+                              const char* message) {
+    try {
+        nlohmann::json response = nlohmann::json::parse(message);
+
+        if (response.contains("event") && response["event"] == "subscribe") {
+            connection.subscription_confirmed = true;
+            // std::cout << "Subscription confirmed" << std::endl;
+        } else if (response.contains("event") &&
+                   response["event"] == "error") {
+            // e.g. subscribing to an instrument OKX does not list
+            std::cerr << "OKX error on connection " << connection.id << ": "
+                      << response.value("msg", std::string()) << std::endl;
+        } else if (response.contains("data")) {
+            for (const nlohmann::json& trade : response["data"]) {
+                measurement_t measurement = Measurement::create(
+                    std::stod(trade["px"].get<std::string>()),
+                    std::stod(trade["sz"].get<std::string>()),
+                    std::stol(trade["ts"].get<std::string>()));
+
+                const std::string& instId =
+                    trade["instId"].get_ref<const std::string&>();
+                enqueueTrade(connection, instId.data(), instId.size(),
+                             measurement);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error parsing JSON: " << e.what() << std::endl;
+    }
+}
+
 int OkxClient::wsCallback(struct lws* wsi, enum lws_callback_reasons reason,
                           void* user, void* in, size_t len) {
+    okx_connection_t* connection =
+        (okx_connection_t*)lws_context_user(lws_get_context(wsi));
+
     switch (reason) {
         case LWS_CALLBACK_CLIENT_ESTABLISHED:
-            std::cout << "WebSocket connection established" << std::endl;
-            if (current_client) {
-                current_client->subscription_confirmed = false;
-                sendSubscription(*current_client);
-            }
+            std::cout << "WebSocket connection " << connection->id
+                      << " established" << std::endl;
+            connection->subscription_confirmed = false;
+            sendSubscription(*connection);
             break;
 
         case LWS_CALLBACK_CLIENT_RECEIVE:
-            // Add the received data to our buffer
-            memcpy(&rx_buffer[rx_buffer_len], in, len);
-            rx_buffer_len += len;
+            if (connection->rx_buffer_len == 0 && !connection->rx_overflow) {
+                connection->rx_start_ms = Clock::nowMs();
+                connection->rx_start_ns = Latency::nowNs();
+            }
+
+            // Add the received data to our buffer, dropping messages that
+            // would not fit
+            if (connection->rx_buffer_len + len >= RX_BUFFER_SIZE) {
+                connection->rx_overflow = true;
+            } else if (!connection->rx_overflow) {
+                memcpy(&connection->rx_buffer[connection->rx_buffer_len], in,
+                       len);
+                connection->rx_buffer_len += len;
+            }
 
             // Process the message if it's complete
             if (lws_is_final_fragment(wsi)) {
-                rx_buffer[rx_buffer_len] = '\0';
-
-                try {
-                    nlohmann::json response = nlohmann::json::parse(rx_buffer);
-
-                    if (response.contains("event") &&
-                        response["event"] == "subscribe") {
-                        if (current_client) {
-                            current_client->subscription_confirmed = true;
-                            // std::cout << "Subscription confirmed" <<
-                            // std::endl;
-                        }
-                    } else if (response.contains("data")) {
-                        response = response["data"][0];
-
-                        measurement_t measurement = Measurement::create(
-                            std::stod(response["px"].get<std::string>()),
-                            std::stod(response["sz"].get<std::string>()),
-                            std::stol(response["ts"].get<std::string>()));
-
-                        // Measurement::displayMeasurement(measurement);
-                        Measurement::storeMeasurement(response["instId"],
-                                                      measurement);
+                if (connection->rx_overflow) {
+                    // Counted on /metrics/ingest, only the first is logged
+                    if (connection->oversized.fetch_add(1) == 0) {
+                        std::cerr << "Dropped oversized message on connection "
+                                  << connection->id << std::endl;
+                    }
+                } else {
+                    connection->rx_buffer[connection->rx_buffer_len] = '\0';
+
+                    // Trade frames are scanned in place, everything else
+                    // goes through the generic JSON parser
+                    if (TradeParser::parseTrades(connection->rx_buffer,
+                                                 connection->rx_buffer_len,
+                                                 storeTrade,
+                                                 connection) < 0) {
+                        handleMessage(*connection, connection->rx_buffer);
                     }
-                } catch (const std::exception& e) {
-                    std::cerr << "Error parsing JSON: " << e.what()
-                              << std::endl;
                 }
 
-                rx_buffer_len = 0;
+                connection->rx_buffer_len = 0;
+                connection->rx_overflow = false;
             }
             break;
 
+        case LWS_CALLBACK_CLIENT_WRITEABLE:
+            sendPendingOp(*connection);
+            break;
+
         case LWS_CALLBACK_CLIENT_CLOSED:
-            std::cout << "WebSocket connection closed" << std::endl;
-            if (current_client) {
-                current_client->client_wsi = nullptr;
-            }
+            std::cout << "WebSocket connection " << connection->id
+                      << " closed" << std::endl;
+            connection->client_wsi = nullptr;
             break;
 
         case LWS_CALLBACK_CLIENT_CONNECTION_ERROR:
-            std::cerr << "WebSocket connection error: ";
+            std::cerr << "WebSocket connection " << connection->id
+                      << " error: ";
             if (in) {
                 std::cerr << (char*)in;
             } else {
@@ -177,9 +455,7 @@ int OkxClient::wsCallback(struct lws* wsi, enum lws_callback_reasons reason,
             }
             std::cerr << std::endl;
 
-            if (current_client) {
-                current_client->client_wsi = nullptr;
-            }
+            connection->client_wsi = nullptr;
             break;
 
         case LWS_CALLBACK_WSI_DESTROY:
@@ -193,30 +469,98 @@ int OkxClient::wsCallback(struct lws* wsi, enum lws_callback_reasons reason,
     return 0;
 }
 
-bool OkxClient::isConnected(const okx_client_t& client) {
-    return client.client_wsi != nullptr && client.subscription_confirmed;
+bool OkxClient::isConnected(const okx_connection_t& connection) {
+    return connection.client_wsi != nullptr &&
+           connection.subscription_confirmed;
 }
 
-lws_context* OkxClient::getContext(const okx_client_t& client) {
-    return client.context;
-}
-
-int OkxClient::waitForSubscriptions(okx_client_t& client) {
+int OkxClient::waitForSubscriptions(okx_connection_t& connection) {
     int wait_attempts = 0;
     const int max_wait_attempts = 100;  // 10 seconds total
 
-    while (wait_attempts < max_wait_attempts && !isConnected(client)) {
-        lws_service(getContext(client), 100);
+    while (wait_attempts < max_wait_attempts && !isConnected(connection) &&
+           connection.running) {
+        lws_service(connection.context, 100);
         usleep(100 * 1000);  // 100ms
         wait_attempts++;
         // std::cout << "Waiting for subscriptions..." << std::endl;
     }
 
-    if (isConnected(client)) {
-        std::cerr << "Subscriptions confirmed" << std::endl;
+    if (isConnected(connection)) {
+        std::cerr << "Subscriptions confirmed on connection " << connection.id
+                  << std::endl;
         return 0;
     } else {
-        std::cout << "Failed to create subscriptions" << std::endl;
+        std::cout << "Failed to create subscriptions on connection "
+                  << connection.id << std::endl;
         return 1;
     }
 }
+
+void* OkxClient::connectionThread(void* arg) {
+    okx_connection_t* connection = (okx_connection_t*)arg;
+
+    // Event loop with reconnection logic
+    int reconnect_attempts = 0;
+    const int max_reconnects = 50;
+    const int reconnect_delay_ms = 5000;  // 5 seconds
+
+    if (!connect(*connection)) {
+        std::cerr << "Failed to initial connection to WebSocket" << std::endl;
+    } else {
+        waitForSubscriptions(*connection);
+    }
+
+    while (connection->running) {
+        if (!isConnected(*connection)) {
+            if (reconnect_attempts >= max_reconnects) {
+                std::cerr << "Maximum reconnection attempts reached on "
+                             "connection "
+                          << connection->id << "." << std::endl;
+                connection->failed = true;
+                break;
+            }
+
+            std::cout << "Connection " << connection->id
+                      << " lost. Attempting to reconnect ("
+                      << reconnect_attempts + 1 << "/" << max_reconnects
+                      << ")..." << std::endl;
+
+            // Wait before reconnecting
+            usleep(reconnect_delay_ms * 1000);
+            if (!connection->running) {
+                break;
+            }
+
+            disconnect(*connection);
+            if (!connect(*connection)) {
+                reconnect_attempts++;
+                std::cerr << "Reconnection attempt failed" << std::endl;
+                continue;
+            }
+
+            if (waitForSubscriptions(*connection)) {
+                reconnect_attempts++;
+                std::cerr << "Connection established but subscription "
+                             "failed, retrying..."
+                          << std::endl;
+                disconnect(*connection);
+                continue;
+            }
+
+            std::cout << "Reconnection successful and subscription confirmed"
+                      << std::endl;
+            reconnect_attempts = 0;
+        }
+
+        // Runtime (un)subscriptions are written from this thread
+        if (connection->hasPendingOps && connection->client_wsi) {
+            lws_callback_on_writable(connection->client_wsi);
+        }
+
+        lws_service(connection->context, 100);
+    }
+
+    disconnect(*connection);
+    return nullptr;
+}
@@ -1,32 +1,93 @@
 #pragma once
 
 #include <libwebsockets.h>
+#include <pthread.h>
 
+#include <atomic>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <vector>
 
+#include "../ingest/tick_queue.hpp"
+
+#define RX_BUFFER_SIZE 16384
+#define TICK_QUEUE_CAPACITY 16384
+
+typedef struct {
+    std::string address;
+    int port;
+    std::string path;
+    bool ssl;
+} okx_endpoint_t;
+
 typedef struct {
+    bool subscribe;  // Otherwise unsubscribe
+    std::string symbol;
+} okx_subscription_op_t;
+
+// One WebSocket connection subscribed to a shard of the symbols, serviced by
+// its own thread
+typedef struct {
+    int id;
+
+    // symbols and pendingOps change at runtime, guarded by symbolsMutex
+    pthread_mutex_t symbolsMutex;
     std::vector<std::string> symbols;
+    std::vector<okx_subscription_op_t> pendingOps;  // Sent when writable
+    std::atomic<bool> hasPendingOps;
+
+    okx_endpoint_t endpoint;
     struct lws_context* context;
     struct lws* client_wsi;
-    bool subscription_confirmed;  // Add this field
+    std::atomic<bool> subscription_confirmed;
+    std::atomic<bool> running;
+    std::atomic<bool> failed;  // Gave up after too many reconnects
+    pthread_t thread;
+
+    // Buffer for receiving data
+    char rx_buffer[RX_BUFFER_SIZE];
+    size_t rx_buffer_len;
+    bool rx_overflow;
+    std::atomic<unsigned long> oversized;  // Messages dropped for not fitting
+    long rx_start_ms;  // Wall clock when the current message started
+    long rx_start_ns;  // Latency::nowNs() when the current message started
+
+    // Parsed trades waiting for the ingest thread
+    tick_queue_t queue;
+} okx_connection_t;
+
+typedef struct {
+    std::vector<okx_connection_t*> connections;
 } okx_client_t;
 
 namespace OkxClient {
 
-// Buffer for receiving data
-extern char rx_buffer[16384];
-extern int rx_buffer_len;
+extern const okx_endpoint_t DEFAULT_ENDPOINT;
 
-okx_client_t create(const std::vector<std::string>& symbols);
+okx_client_t* create(const std::vector<std::string>& symbols,
+                     int numConnections,
+                     const okx_endpoint_t& endpoint = DEFAULT_ENDPOINT);
+// Parses ws://host:port/path or wss://host:port/path
+bool parseEndpoint(const std::string& url, okx_endpoint_t& endpoint);
 void destroy(okx_client_t& client);
-bool connect(okx_client_t& client);
-void sendSubscription(okx_client_t& client);
-bool isConnected(const okx_client_t& client);
-lws_context* getContext(const okx_client_t& client);
+void start(okx_client_t& client);
+void stop(okx_client_t& client);
+bool isRunning(const okx_client_t& client);
+
+// Moves a symbol onto the least loaded connection, or off its connection.
+// The message goes out from that connection's service thread.
+void subscribe(okx_client_t& client, const std::string& symbol);
+void unsubscribe(okx_client_t& client, const std::string& symbol);
+
+bool connect(okx_connection_t& connection);
+void disconnect(okx_connection_t& connection);
+void sendSubscription(okx_connection_t& connection);
+void sendPendingOp(okx_connection_t& connection);
+void handleMessage(okx_connection_t& connection, const char* message);
+bool isConnected(const okx_connection_t& connection);
+int waitForSubscriptions(okx_connection_t& connection);
+void* connectionThread(void* arg);
 int wsCallback(struct lws* wsi, enum lws_callback_reasons reason, void* user,
                void* in, size_t len);
-int waitForSubscriptions(okx_client_t& client);
 
 }  // namespace OkxClient
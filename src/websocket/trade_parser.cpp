@@ -0,0 +1,280 @@
+#include "trade_parser.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+static const double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,
+                               1e7,  1e8,  1e9,  1e10, 1e11, 1e12, 1e13,
+                               1e14, 1e15, 1e16, 1e17, 1e18};
+static const int MAX_FAST_DIGITS = 18;
+
+static const char CHANNEL_TRADES[] = "\"channel\":\"trades\"";
+static const char DATA_ARRAY[] = "\"data\":[";
+
+static const char* findToken(const char* p, const char* end,
+                             const char* token, size_t tokenLen) {
+    while (p + tokenLen <= end) {
+        const char* hit = (const char*)memchr(p, token[0], end - p);
+        if (hit == nullptr || hit + tokenLen > end) {
+            return nullptr;
+        }
+        if (memcmp(hit, token, tokenLen) == 0) {
+            return hit;
+        }
+        p = hit + 1;
+    }
+    return nullptr;
+}
+
+static const char* skipWhitespace(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        p++;
+    }
+    return p;
+}
+
+// Reads a JSON string without escapes starting at the opening quote.
+// Returns the position after the closing quote, or nullptr.
+static const char* readString(const char* p, const char* end,
+                              const char*& str, size_t& strLen) {
+    if (p >= end || *p != '"') {
+        return nullptr;
+    }
+    p++;
+
+    const char* close = (const char*)memchr(p, '"', end - p);
+    if (close == nullptr || memchr(p, '\\', close - p) != nullptr) {
+        return nullptr;
+    }
+
+    str = p;
+    strLen = close - p;
+    return close + 1;
+}
+
+// Skips a non-string scalar value (number, true, false, null)
+static const char* skipScalar(const char* p, const char* end) {
+    while (p < end && *p != ',' && *p != '}' && *p != ']') {
+        if (*p == '{' || *p == '[' || *p == '"') {
+            return nullptr;
+        }
+        p++;
+    }
+    return p;
+}
+
+// On malformed input the frame goes to the generic path only if nothing has
+// been emitted yet, otherwise trades would be stored twice.
+static int abortScan(int emitted) { return emitted > 0 ? emitted : -1; }
+
+static bool keyEquals(const char* key, size_t keyLen, const char* expected,
+                      size_t expectedLen) {
+    return keyLen == expectedLen && memcmp(key, expected, keyLen) == 0;
+}
+
+static bool parseWithStrtod(const char* s, size_t len, double& out) {
+    char tmp[64];
+    if (len == 0 || len >= sizeof tmp) {
+        return false;
+    }
+    memcpy(tmp, s, len);
+    tmp[len] = '\0';
+
+    char* parsedEnd;
+    out = strtod(tmp, &parsedEnd);
+    return parsedEnd == tmp + len;
+}
+
+bool TradeParser::parseDecimal(const char* s, size_t len, double& out) {
+    const char* p = s;
+    const char* end = s + len;
+    bool negative = false;
+
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p == end) {
+        return false;
+    }
+
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int fractionDigits = 0;
+    bool seenDot = false;
+
+    for (; p < end; p++) {
+        char c = *p;
+        if (c >= '0' && c <= '9') {
+            mantissa = mantissa * 10 + (c - '0');
+            digits++;
+            if (seenDot) {
+                fractionDigits++;
+            }
+        } else if (c == '.' && !seenDot) {
+            seenDot = true;
+        } else {
+            // Exponents and anything unusual take the slow path
+            return parseWithStrtod(s, len, out);
+        }
+
+        if (digits > MAX_FAST_DIGITS) {
+            return parseWithStrtod(s, len, out);
+        }
+    }
+
+    if (digits == 0) {
+        return false;
+    }
+
+    double value = (double)mantissa / POW10[fractionDigits];
+    out = negative ? -value : value;
+    return true;
+}
+
+bool TradeParser::parseInteger(const char* s, size_t len, long& out) {
+    const char* p = s;
+    const char* end = s + len;
+    bool negative = false;
+
+    if (p < end && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p == end || end - p > MAX_FAST_DIGITS) {
+        return false;
+    }
+
+    long value = 0;
+    for (; p < end; p++) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        value = value * 10 + (*p - '0');
+    }
+
+    out = negative ? -value : value;
+    return true;
+}
+
+int TradeParser::parseTrades(const char* buf, size_t len,
+                             trade_handler_t handler, void* user) {
+    const char* end = buf + len;
+
+    if (findToken(buf, end, CHANNEL_TRADES, sizeof CHANNEL_TRADES - 1) ==
+        nullptr) {
+        return -1;
+    }
+
+    const char* data = findToken(buf, end, DATA_ARRAY, sizeof DATA_ARRAY - 1);
+    if (data == nullptr) {
+        return -1;
+    }
+
+    const char* p = skipWhitespace(data + sizeof DATA_ARRAY - 1, end);
+    int count = 0;
+
+    if (p < end && *p == ']') {
+        return 0;
+    }
+
+    while (p < end) {
+        if (*p != '{') {
+            return abortScan(count);
+        }
+        p++;
+
+        const char* instId = nullptr;
+        size_t instIdLen = 0;
+        const char* px = nullptr;
+        size_t pxLen = 0;
+        const char* sz = nullptr;
+        size_t szLen = 0;
+        const char* ts = nullptr;
+        size_t tsLen = 0;
+
+        // Fields of a single trade object
+        while (true) {
+            p = skipWhitespace(p, end);
+            if (p < end && *p == '}') {
+                p++;
+                break;
+            }
+
+            const char* key;
+            size_t keyLen;
+            p = readString(p, end, key, keyLen);
+            if (p == nullptr) {
+                return abortScan(count);
+            }
+
+            p = skipWhitespace(p, end);
+            if (p >= end || *p != ':') {
+                return abortScan(count);
+            }
+            p = skipWhitespace(p + 1, end);
+
+            const char* value = nullptr;
+            size_t valueLen = 0;
+            if (p < end && *p == '"') {
+                p = readString(p, end, value, valueLen);
+            } else {
+                p = skipScalar(p, end);
+            }
+            if (p == nullptr) {
+                return abortScan(count);
+            }
+
+            if (value != nullptr) {
+                if (keyEquals(key, keyLen, "px", 2)) {
+                    px = value;
+                    pxLen = valueLen;
+                } else if (keyEquals(key, keyLen, "sz", 2)) {
+                    sz = value;
+                    szLen = valueLen;
+                } else if (keyEquals(key, keyLen, "ts", 2)) {
+                    ts = value;
+                    tsLen = valueLen;
+                } else if (keyEquals(key, keyLen, "instId", 6)) {
+                    instId = value;
+                    instIdLen = valueLen;
+                }
+            }
+
+            p = skipWhitespace(p, end);
+            if (p < end && *p == ',') {
+                p++;
+            } else if (p < end && *p == '}') {
+                p++;
+                break;
+            } else {
+                return abortScan(count);
+            }
+        }
+
+        if (instId == nullptr || px == nullptr || sz == nullptr ||
+            ts == nullptr) {
+            return abortScan(count);
+        }
+
+        measurement_t m;
+        if (!parseDecimal(px, pxLen, m.px) || !parseDecimal(sz, szLen, m.sz) ||
+            !parseInteger(ts, tsLen, m.ts)) {
+            return abortScan(count);
+        }
+
+        handler(instId, instIdLen, m, user);
+        count++;
+
+        p = skipWhitespace(p, end);
+        if (p < end && *p == ',') {
+            p = skipWhitespace(p + 1, end);
+        } else if (p < end && *p == ']') {
+            return count;
+        } else {
+            return abortScan(count);
+        }
+    }
+
+    return abortScan(count);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+
+#include "../measurement/measurement.hpp"
+
+// Called once per trade found in a frame. instId points into the receive
+// buffer and is not null-terminated.
+typedef void (*trade_handler_t)(const char* instId, size_t instIdLen,
+                                const measurement_t& m, void* user);
+
+namespace TradeParser {
+
+// Scans a raw OKX `trades` channel frame in place and calls handler for every
+// entry of its `data` array. Never allocates.
+// Returns the number of trades emitted, or -1 if the frame is not a trades
+// data frame (events, errors, unexpected layout) and should be handed to the
+// generic JSON path instead.
+int parseTrades(const char* buf, size_t len, trade_handler_t handler,
+                void* user);
+
+bool parseDecimal(const char* s, size_t len, double& out);
+bool parseInteger(const char* s, size_t len, long& out);
+
+}  // namespace TradeParser
@@ -0,0 +1,366 @@
+// Local stand-in for the OKX v5 public WebSocket, used to load test the
+// ingest path. Accepts {"op":"subscribe","args":[{"channel":"trades",...}]}
+// (and the matching "unsubscribe") and streams synthetic trades for the
+// subscribed instruments at a configurable rate and burst shape.
+//
+//   ./fake_okx --port 9000 --rate 2000 --batch 1 --symbols 0
+//              --burst-factor 10 --burst-every-ms 10000 --burst-ms 500
+//   ./crypto_monitor --endpoint ws://127.0.0.1:9000/ws/v5/public
+
+#include <libwebsockets.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "websocket/okx_client.hpp"
+
+typedef struct {
+    int port;
+    double rate;             // Messages per second per connection
+    int batch;               // Trades per message
+    size_t maxSymbols;       // 0 = every subscribed instrument
+    double burstFactor;      // Rate multiplier while bursting
+    long burstEveryMs;       // Period of bursts, 0 = no bursts
+    long burstMs;            // Length of each burst
+} feed_config_t;
+
+typedef struct {
+    std::vector<std::string> symbols;
+    std::vector<double> prices;
+    std::deque<std::string> replies;
+    std::string rx;
+    double owed;  // Messages due but not yet sent
+    std::chrono::steady_clock::time_point lastRefill;
+    unsigned long tradeId;
+    size_t nextSymbol;
+    std::mt19937 rng;
+} session_state_t;
+
+// lws hands out zeroed per-session memory, the C++ state lives on the heap
+typedef struct {
+    session_state_t* state;
+} session_t;
+
+static const long TIMER_USECS = 1000;
+static const size_t MAX_MESSAGE = 64 * 1024;
+// Trade frames have to fit the client's receive buffer with its terminator
+static const size_t MAX_FRAME = RX_BUFFER_SIZE - 1;
+static const char* const FRAME_START =
+    "{\"arg\":{\"channel\":\"trades\",\"instId\":\"%s\"},\"data\":[";
+static const char* const TRADE_FORMAT =
+    "%s{\"instId\":\"%s\",\"tradeId\":\"%lu\",\"px\":\"%.6f\","
+    "\"sz\":\"%.6f\",\"side\":\"%s\",\"ts\":\"%ld\",\"count\":\"1\","
+    "\"source\":\"0\"}";
+
+static feed_config_t config = {9000, 1000, 1, 0, 1, 0, 0};
+static volatile sig_atomic_t running = true;
+static std::chrono::steady_clock::time_point startTime;
+static unsigned long messagesSent = 0;
+static unsigned long tradesSent = 0;
+static unsigned long messagesBehind = 0;  // Owed messages dropped as lag
+
+static void signalHandler(int signal) { running = false; }
+
+static long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+static double currentRate() {
+    if (config.burstEveryMs <= 0) {
+        return config.rate;
+    }
+
+    long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now() - startTime)
+                       .count();
+    bool bursting = elapsed % config.burstEveryMs < config.burstMs;
+    return bursting ? config.rate * config.burstFactor : config.rate;
+}
+
+static void refill(session_state_t& state) {
+    auto now = std::chrono::steady_clock::now();
+    double seconds =
+        std::chrono::duration<double>(now - state.lastRefill).count();
+    state.lastRefill = now;
+
+    double rate = currentRate();
+    state.owed += rate * seconds;
+
+    // Never build up more than a second of backlog
+    if (state.owed > rate) {
+        messagesBehind += (unsigned long)(state.owed - rate);
+        state.owed = rate;
+    }
+}
+
+static void subscribe(session_state_t& state, const char* message) {
+    try {
+        nlohmann::json request = nlohmann::json::parse(message);
+        std::string op = request.value("op", "");
+        if (op != "subscribe" && op != "unsubscribe") {
+            return;
+        }
+
+        for (const nlohmann::json& arg : request["args"]) {
+            std::string instId = arg.value("instId", "");
+            if (instId.empty() || arg.value("channel", "") != "trades") {
+                continue;
+            }
+
+            std::vector<std::string>::iterator it =
+                std::find(state.symbols.begin(), state.symbols.end(), instId);
+            if (op == "unsubscribe") {
+                if (it != state.symbols.end()) {
+                    state.prices.erase(state.prices.begin() +
+                                       (it - state.symbols.begin()));
+                    state.symbols.erase(it);
+                }
+            } else if (it == state.symbols.end() &&
+                       (config.maxSymbols == 0 ||
+                        state.symbols.size() < config.maxSymbols)) {
+                state.symbols.push_back(instId);
+                state.prices.push_back(100.0 + state.symbols.size());
+            }
+
+            nlohmann::json reply = {{"event", op},
+                                    {"arg", arg},
+                                    {"connId", "fake0001"}};
+            state.replies.push_back(reply.dump());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring malformed request: " << e.what() << std::endl;
+    }
+}
+
+// Formats one trades message for the next symbol in round-robin order
+static size_t buildTrades(session_state_t& state, char* out, size_t size) {
+    size_t index = state.nextSymbol++ % state.symbols.size();
+    const char* instId = state.symbols[index].c_str();
+    std::normal_distribution<double> step(0.0, 0.0005);
+    std::uniform_real_distribution<double> amount(0.001, 5.0);
+
+    int len = snprintf(out, size, FRAME_START, instId);
+    long ts = nowMs();
+
+    for (int i = 0; i < config.batch && (size_t)len < size; i++) {
+        double& price = state.prices[index];
+        price *= 1.0 + step(state.rng);
+
+        len += snprintf(out + len, size - len, TRADE_FORMAT, i > 0 ? "," : "",
+                        instId, state.tradeId++, price, amount(state.rng),
+                        i % 2 ? "sell" : "buy", ts);
+    }
+
+    if ((size_t)len + 2 >= size) {
+        return 0;
+    }
+    len += snprintf(out + len, size - len, "]}");
+    return len;
+}
+
+// Most trades per frame that fit MAX_FRAME for the longest instId the
+// monitor accepts, the largest trade ids and prices below a billion
+static int maxBatch() {
+    const std::string instId(32, 'X');
+    size_t start = snprintf(nullptr, 0, FRAME_START, instId.c_str());
+    size_t trade = snprintf(nullptr, 0, TRADE_FORMAT, ",", instId.c_str(),
+                            ULONG_MAX, 999999999.0, 5.0, "sell", LONG_MAX);
+    return (MAX_FRAME - start - 2) / trade;
+}
+
+static int sendText(struct lws* wsi, const char* text, size_t len) {
+    static unsigned char buf[LWS_PRE + MAX_MESSAGE];
+    memcpy(&buf[LWS_PRE], text, len);
+    return lws_write(wsi, &buf[LWS_PRE], len, LWS_WRITE_TEXT) < (int)len;
+}
+
+static int feedCallback(struct lws* wsi, enum lws_callback_reasons reason,
+                        void* user, void* in, size_t len) {
+    session_t* session = (session_t*)user;
+
+    switch (reason) {
+        case LWS_CALLBACK_ESTABLISHED:
+            session->state = new session_state_t();
+            session->state->owed = 0;
+            session->state->lastRefill = std::chrono::steady_clock::now();
+            session->state->tradeId = 1;
+            session->state->nextSymbol = 0;
+            session->state->rng.seed(std::random_device()());
+            lws_set_timer_usecs(wsi, TIMER_USECS);
+            std::cout << "Client connected" << std::endl;
+            break;
+
+        case LWS_CALLBACK_RECEIVE:
+            session->state->rx.append((const char*)in, len);
+            if (lws_is_final_fragment(wsi)) {
+                subscribe(*session->state, session->state->rx.c_str());
+                session->state->rx.clear();
+                lws_callback_on_writable(wsi);
+            }
+            break;
+
+        case LWS_CALLBACK_TIMER:
+            refill(*session->state);
+            if (session->state->owed >= 1 || !session->state->replies.empty()) {
+                lws_callback_on_writable(wsi);
+            }
+            lws_set_timer_usecs(wsi, TIMER_USECS);
+            break;
+
+        case LWS_CALLBACK_SERVER_WRITEABLE: {
+            session_state_t& state = *session->state;
+
+            // One write per writeable callback, as lws requires
+            if (!state.replies.empty()) {
+                const std::string& reply = state.replies.front();
+                if (sendText(wsi, reply.c_str(), reply.size())) {
+                    return -1;
+                }
+                state.replies.pop_front();
+            } else if (state.owed >= 1 && !state.symbols.empty()) {
+                static char message[MAX_FRAME + 1];
+                size_t messageLen = buildTrades(state, message, sizeof message);
+                if (messageLen == 0) {
+                    std::cerr << "Trades message longer than " << MAX_FRAME
+                              << " bytes, closing" << std::endl;
+                    return -1;
+                }
+                if (sendText(wsi, message, messageLen)) {
+                    return -1;
+                }
+                state.owed -= 1;
+                messagesSent++;
+                tradesSent += config.batch;
+            }
+
+            if (!state.replies.empty() ||
+                (state.owed >= 1 && !state.symbols.empty())) {
+                lws_callback_on_writable(wsi);
+            }
+            break;
+        }
+
+        case LWS_CALLBACK_CLOSED:
+            delete session->state;
+            session->state = nullptr;
+            std::cout << "Client disconnected" << std::endl;
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static const struct lws_protocols protocols[] = {
+    {
+        "okx-protocol",
+        feedCallback,
+        sizeof(session_t),
+        MAX_MESSAGE,
+    },
+    {NULL, NULL, 0, 0}  // terminator
+};
+
+static bool parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+
+        if (strcmp(argv[i], "--port") == 0) {
+            config.port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0) {
+            config.rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            config.batch = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--symbols") == 0) {
+            config.maxSymbols = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--burst-factor") == 0) {
+            config.burstFactor = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--burst-every-ms") == 0) {
+            config.burstEveryMs = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--burst-ms") == 0) {
+            config.burstMs = atol(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+
+    if (config.batch > maxBatch()) {
+        std::cerr << "--batch above " << maxBatch() << " does not fit the "
+                  << RX_BUFFER_SIZE << " byte receive buffer of the client"
+                  << std::endl;
+        return false;
+    }
+
+    return config.port > 0 && config.rate > 0 && config.batch > 0;
+}
+
+int main(int argc, char** argv) {
+    if (!parseArgs(argc, argv)) {
+        std::cerr << "Usage: " << argv[0]
+                  << " [--port N] [--rate MSG_PER_S] [--batch TRADES]"
+                     " [--symbols N] [--burst-factor F]"
+                     " [--burst-every-ms MS] [--burst-ms MS]"
+                  << std::endl;
+        return 1;
+    }
+
+    signal(SIGINT, signalHandler);
+
+    struct lws_context_creation_info info;
+    memset(&info, 0, sizeof info);
+    info.port = config.port;
+    info.protocols = protocols;
+    info.gid = -1;
+    info.uid = -1;
+
+    struct lws_context* context = lws_create_context(&info);
+    if (!context) {
+        std::cerr << "lws init failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Fake OKX feed on ws://127.0.0.1:" << config.port
+              << "/ws/v5/public, " << config.rate << " msg/s x "
+              << config.batch << " trades per connection" << std::endl;
+
+    startTime = std::chrono::steady_clock::now();
+    auto lastReport = startTime;
+    unsigned long lastMessages = 0;
+    unsigned long lastTrades = 0;
+
+    while (running) {
+        lws_service(context, 0);
+
+        auto now = std::chrono::steady_clock::now();
+        double seconds =
+            std::chrono::duration<double>(now - lastReport).count();
+        if (seconds >= 1.0) {
+            printf("%.0f msg/s, %.0f trades/s, %lu behind\n",
+                   (messagesSent - lastMessages) / seconds,
+                   (tradesSent - lastTrades) / seconds, messagesBehind);
+            fflush(stdout);
+            lastMessages = messagesSent;
+            lastTrades = tradesSent;
+            lastReport = now;
+        }
+    }
+
+    lws_context_destroy(context);
+    return 0;
+}